@@ -0,0 +1,812 @@
+//
+// AdaptiveRadixTree.h
+//
+// Key index over byte-comparable keys, after Leis et al., "The Adaptive
+// Radix Tree". Inner nodes grow and shrink between four layouts sized
+// for 4, 16, 48 and 256 children, so sparse levels stay small while
+// dense levels index children directly. Leaves hold the key and its
+// value. Keys are visited in the order of their bytes.
+//
+//
+
+#ifndef __ADAPTIVE_RADIX_TREE__
+#define __ADAPTIVE_RADIX_TREE__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Traits turning a key into bytes that compare, byte by byte, in the same order
+ * as the keys. Integral keys are written big endian with the sign bit flipped.
+ */
+template <typename K>
+struct KeyBytes {
+    static_assert(std::is_integral<K>::value, "KeyBytes needs a specialization for this key type");
+
+    static std::string bytes(const K& key) {
+        typedef typename std::make_unsigned<K>::type Unsigned;
+        Unsigned value = static_cast<Unsigned>(key);
+        if (std::is_signed<K>::value) {
+            value ^= Unsigned(1) << (sizeof(Unsigned) * 8 - 1);
+        }
+        std::string out(sizeof(Unsigned), '\0');
+        for (size_t i = 0; i < sizeof(Unsigned); ++i) {
+            out[i] = static_cast<char>(value >> (8 * (sizeof(Unsigned) - 1 - i)));
+        }
+        return out;
+    }
+};
+
+/** Strings are their own bytes. */
+template <>
+struct KeyBytes<std::string> {
+    static const std::string& bytes(const std::string& key) {
+        return key;
+    }
+};
+
+/** Adaptive radix tree implementing the key index interface of KeyIndex.h. */
+template <typename K, typename T>
+class AdaptiveRadixTree {
+public:
+    /** Constructor. No memory is allocated until the first key is inserted. */
+    AdaptiveRadixTree();
+
+    AdaptiveRadixTree(AdaptiveRadixTree&& other) noexcept;
+
+    AdaptiveRadixTree(const AdaptiveRadixTree& other) = delete;
+
+    ~AdaptiveRadixTree();
+
+    AdaptiveRadixTree& operator=(AdaptiveRadixTree&& other) noexcept;
+
+    AdaptiveRadixTree& operator=(const AdaptiveRadixTree& other) = delete;
+
+    /** Returns the value mapped to key, or nullptr if there is none. */
+    T* find(const K& key);
+
+    /** Returns the value mapped to key, inserting a default constructed one if there is none. */
+    T& operator[](const K& key);
+
+    /** Removes key. Returns true if it was present. */
+    bool erase(const K& key);
+
+    /** Calls fn(key, value) for every key in byte order. fn must not insert or erase keys. */
+    template <typename F>
+    void forEach(F fn);
+
+    /** Returns the number of keys. */
+    size_t size() const;
+
+    /** Removes every key. */
+    void clear() noexcept;
+
+    /** Exchanges the contents of this tree with other in constant time. */
+    void swap(AdaptiveRadixTree& other) noexcept;
+
+private:
+    /** Number of prefix bytes kept in a node. Longer prefixes are checked against a leaf. */
+    static const size_t kMaxPrefix = 8;
+
+    enum NodeType : uint8_t { kNode4, kNode16, kNode48, kNode256 };
+
+    struct Leaf {
+        explicit Leaf(const K& key) : key(key), value() {}
+
+        K key;
+
+        T value;
+    };
+
+    /**
+     * Header shared by every inner node. A child reference is a Node* or, with
+     * its low bit set, a Leaf*.
+     */
+    struct Node {
+        NodeType type;
+
+        uint16_t count;
+
+        /** Number of bytes every key below this node shares after the parent's byte. */
+        uint32_t prefix_length;
+
+        /** The first kMaxPrefix bytes of the prefix. */
+        unsigned char prefix[kMaxPrefix];
+
+        /** Leaf of the key ending right after the prefix, if any. */
+        Leaf* terminal;
+    };
+
+    /** Up to 4 children with sorted key bytes. */
+    struct Node4 : Node {
+        unsigned char keys[4];
+        void* children[4];
+    };
+
+    /** Up to 16 children with sorted key bytes, searched 16 at a time. */
+    struct Node16 : Node {
+        unsigned char keys[16];
+        void* children[16];
+    };
+
+    /** Up to 48 children, located through a byte indexed table of slot + 1. */
+    struct Node48 : Node {
+        unsigned char index[256];
+        void* children[48];
+    };
+
+    /** Up to 256 children indexed directly by byte. */
+    struct Node256 : Node {
+        void* children[256];
+    };
+
+    static bool isLeaf(void* ref);
+
+    static Leaf* asLeaf(void* ref);
+
+    static void* leafRef(Leaf* leaf);
+
+    /** Allocates an empty node of the given type. */
+    static Node* newNode(NodeType type);
+
+    static void deleteNode(Node* node);
+
+    /** Returns the slot of the child of node for byte, or nullptr if there is none. */
+    static void** findChild(Node* node, unsigned char byte);
+
+    /** Adds child under byte to node, which slot points at, growing the node when full. */
+    static void addChild(void** slot, Node* node, unsigned char byte, void* child);
+
+    /** Removes the child for byte from node, which slot points at, shrinking the node when sparse. */
+    static void removeChild(void** slot, Node* node, unsigned char byte);
+
+    /** Replaces node, which slot points at, by a smaller node or its only remaining entry. */
+    static void shrink(void** slot, Node* node);
+
+    /** Copies the header of from to to, without the child count. */
+    static void copyHeader(Node* to, const Node* from);
+
+    /** Sets the prefix of node to the length bytes of key starting at depth. */
+    static void setPrefix(Node* node, const std::string& key, size_t depth, size_t length);
+
+    /** Returns the number of leading bytes of the prefix of node that key matches at depth. */
+    static size_t prefixMismatch(Node* node, const std::string& key, size_t depth);
+
+    /** Returns the leaf with the smallest key below ref. */
+    static Leaf* minimumLeaf(void* ref);
+
+    template <typename F>
+    static void visit(void* ref, F& fn);
+
+    /** Frees ref and everything below it. */
+    static void destroy(void* ref);
+
+    void* root;
+
+    size_t count;
+};
+
+
+/** Public Method implementations */
+template <typename K, typename T>
+AdaptiveRadixTree<K, T>::AdaptiveRadixTree() : root(nullptr), count(0) {}
+
+template <typename K, typename T>
+AdaptiveRadixTree<K, T>::AdaptiveRadixTree(AdaptiveRadixTree&& other) noexcept
+    : root(other.root), count(other.count) {
+    other.root = nullptr;
+    other.count = 0;
+}
+
+template <typename K, typename T>
+AdaptiveRadixTree<K, T>::~AdaptiveRadixTree() {
+    clear();
+}
+
+template <typename K, typename T>
+AdaptiveRadixTree<K, T>& AdaptiveRadixTree<K, T>::operator=(AdaptiveRadixTree&& other) noexcept {
+    AdaptiveRadixTree(std::move(other)).swap(*this);
+    return *this;
+}
+
+template <typename K, typename T>
+T* AdaptiveRadixTree<K, T>::find(const K& key) {
+    const std::string& bytes = KeyBytes<K>::bytes(key);
+    void* ref = root;
+    size_t depth = 0;
+    while (ref) {
+        if (isLeaf(ref)) {
+            Leaf* leaf = asLeaf(ref);
+            return leaf->key == key ? &leaf->value : nullptr;
+        }
+        Node* node = static_cast<Node*>(ref);
+        if (node->prefix_length) {
+            // only the stored bytes are checked; the leaf comparison catches the rest
+            if (depth + node->prefix_length > bytes.size()) {
+                return nullptr;
+            }
+            size_t stored = node->prefix_length < kMaxPrefix ? node->prefix_length : kMaxPrefix;
+            if (std::memcmp(node->prefix, bytes.data() + depth, stored) != 0) {
+                return nullptr;
+            }
+            depth += node->prefix_length;
+        }
+        if (depth == bytes.size()) {
+            return node->terminal && node->terminal->key == key ? &node->terminal->value : nullptr;
+        }
+        void** child = findChild(node, bytes[depth]);
+        ref = child ? *child : nullptr;
+        ++depth;
+    }
+    return nullptr;
+}
+
+template <typename K, typename T>
+T& AdaptiveRadixTree<K, T>::operator[](const K& key) {
+    const std::string& bytes = KeyBytes<K>::bytes(key);
+    void** slot = &root;
+    size_t depth = 0;
+    while (*slot) {
+        if (isLeaf(*slot)) {
+            Leaf* existing = asLeaf(*slot);
+            if (existing->key == key) {
+                return existing->value;
+            }
+            // two keys now share this position; a node holds their common bytes
+            const std::string& other = KeyBytes<K>::bytes(existing->key);
+            size_t common = 0;
+            while (depth + common < bytes.size() && depth + common < other.size()
+                    && bytes[depth + common] == other[depth + common]) {
+                ++common;
+            }
+            Node* node = newNode(kNode4);
+            setPrefix(node, bytes, depth, common);
+            Leaf* leaf = new Leaf(key);
+            depth += common;
+            if (depth == other.size()) {
+                node->terminal = existing;
+            } else {
+                addChild(slot, node, other[depth], leafRef(existing));
+            }
+            if (depth == bytes.size()) {
+                node->terminal = leaf;
+            } else {
+                addChild(slot, node, bytes[depth], leafRef(leaf));
+            }
+            *slot = node;
+            ++count;
+            return leaf->value;
+        }
+
+        Node* node = static_cast<Node*>(*slot);
+        if (node->prefix_length) {
+            size_t mismatch = prefixMismatch(node, bytes, depth);
+            if (mismatch < node->prefix_length) {
+                // key leaves the prefix early; split the prefix at the mismatch
+                const std::string& full = KeyBytes<K>::bytes(minimumLeaf(node)->key);
+                Node* parent = newNode(kNode4);
+                setPrefix(parent, full, depth, mismatch);
+                unsigned char node_byte = full[depth + mismatch];
+                setPrefix(node, full, depth + mismatch + 1, node->prefix_length - mismatch - 1);
+                addChild(slot, parent, node_byte, node);
+                Leaf* leaf = new Leaf(key);
+                if (depth + mismatch == bytes.size()) {
+                    parent->terminal = leaf;
+                } else {
+                    addChild(slot, parent, bytes[depth + mismatch], leafRef(leaf));
+                }
+                *slot = parent;
+                ++count;
+                return leaf->value;
+            }
+            depth += node->prefix_length;
+        }
+        if (depth == bytes.size()) {
+            if (!node->terminal) {
+                node->terminal = new Leaf(key);
+                ++count;
+            }
+            return node->terminal->value;
+        }
+        void** child = findChild(node, bytes[depth]);
+        if (!child) {
+            Leaf* leaf = new Leaf(key);
+            addChild(slot, node, bytes[depth], leafRef(leaf));
+            ++count;
+            return leaf->value;
+        }
+        slot = child;
+        ++depth;
+    }
+    Leaf* leaf = new Leaf(key);
+    *slot = leafRef(leaf);
+    ++count;
+    return leaf->value;
+}
+
+template <typename K, typename T>
+bool AdaptiveRadixTree<K, T>::erase(const K& key) {
+    const std::string& bytes = KeyBytes<K>::bytes(key);
+    void** slot = &root;
+    void** parent_slot = nullptr;
+    unsigned char parent_byte = 0;
+    size_t depth = 0;
+    while (*slot) {
+        if (isLeaf(*slot)) {
+            Leaf* leaf = asLeaf(*slot);
+            if (!(leaf->key == key)) {
+                return false;
+            }
+            if (parent_slot) {
+                removeChild(parent_slot, static_cast<Node*>(*parent_slot), parent_byte);
+            } else {
+                *slot = nullptr;
+            }
+            delete leaf;
+            --count;
+            return true;
+        }
+        Node* node = static_cast<Node*>(*slot);
+        if (node->prefix_length) {
+            if (prefixMismatch(node, bytes, depth) < node->prefix_length) {
+                return false;
+            }
+            depth += node->prefix_length;
+        }
+        if (depth == bytes.size()) {
+            if (!node->terminal || !(node->terminal->key == key)) {
+                return false;
+            }
+            delete node->terminal;
+            node->terminal = nullptr;
+            --count;
+            shrink(slot, node);
+            return true;
+        }
+        void** child = findChild(node, bytes[depth]);
+        if (!child) {
+            return false;
+        }
+        parent_slot = slot;
+        parent_byte = bytes[depth];
+        slot = child;
+        ++depth;
+    }
+    return false;
+}
+
+template <typename K, typename T>
+template <typename F>
+void AdaptiveRadixTree<K, T>::forEach(F fn) {
+    if (root) {
+        visit(root, fn);
+    }
+}
+
+template <typename K, typename T>
+size_t AdaptiveRadixTree<K, T>::size() const {
+    return count;
+}
+
+template <typename K, typename T>
+void AdaptiveRadixTree<K, T>::clear() noexcept {
+    if (root) {
+        destroy(root);
+    }
+    root = nullptr;
+    count = 0;
+}
+
+template <typename K, typename T>
+void AdaptiveRadixTree<K, T>::swap(AdaptiveRadixTree& other) noexcept {
+    std::swap(root, other.root);
+    std::swap(count, other.count);
+}
+
+
+/** Private Method Implementations */
+template <typename K, typename T>
+bool AdaptiveRadixTree<K, T>::isLeaf(void* ref) {
+    return reinterpret_cast<uintptr_t>(ref) & 1;
+}
+
+template <typename K, typename T>
+typename AdaptiveRadixTree<K, T>::Leaf* AdaptiveRadixTree<K, T>::asLeaf(void* ref) {
+    return reinterpret_cast<Leaf*>(reinterpret_cast<uintptr_t>(ref) & ~uintptr_t(1));
+}
+
+template <typename K, typename T>
+void* AdaptiveRadixTree<K, T>::leafRef(Leaf* leaf) {
+    return reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(leaf) | 1);
+}
+
+template <typename K, typename T>
+typename AdaptiveRadixTree<K, T>::Node* AdaptiveRadixTree<K, T>::newNode(NodeType type) {
+    Node* node;
+    switch (type) {
+    case kNode4: node = new Node4(); break;
+    case kNode16: node = new Node16(); break;
+    case kNode48: node = new Node48(); break;
+    default: node = new Node256(); break;
+    }
+    node->type = type;
+    node->count = 0;
+    node->prefix_length = 0;
+    node->terminal = nullptr;
+    return node;
+}
+
+template <typename K, typename T>
+void AdaptiveRadixTree<K, T>::deleteNode(Node* node) {
+    switch (node->type) {
+    case kNode4: delete static_cast<Node4*>(node); break;
+    case kNode16: delete static_cast<Node16*>(node); break;
+    case kNode48: delete static_cast<Node48*>(node); break;
+    default: delete static_cast<Node256*>(node); break;
+    }
+}
+
+template <typename K, typename T>
+void** AdaptiveRadixTree<K, T>::findChild(Node* node, unsigned char byte) {
+    switch (node->type) {
+    case kNode4: {
+        Node4* node4 = static_cast<Node4*>(node);
+        for (unsigned i = 0; i < node->count; ++i) {
+            if (node4->keys[i] == byte) {
+                return &node4->children[i];
+            }
+        }
+        return nullptr;
+    }
+    case kNode16: {
+        Node16* node16 = static_cast<Node16*>(node);
+#if defined(__SSE2__)
+        __m128i matches = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(byte)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i*>(node16->keys)));
+        unsigned mask = _mm_movemask_epi8(matches) & ((1u << node->count) - 1);
+        return mask ? &node16->children[__builtin_ctz(mask)] : nullptr;
+#else
+        for (unsigned i = 0; i < node->count; ++i) {
+            if (node16->keys[i] == byte) {
+                return &node16->children[i];
+            }
+        }
+        return nullptr;
+#endif
+    }
+    case kNode48: {
+        Node48* node48 = static_cast<Node48*>(node);
+        return node48->index[byte] ? &node48->children[node48->index[byte] - 1] : nullptr;
+    }
+    default: {
+        Node256* node256 = static_cast<Node256*>(node);
+        return node256->children[byte] ? &node256->children[byte] : nullptr;
+    }
+    }
+}
+
+template <typename K, typename T>
+void AdaptiveRadixTree<K, T>::addChild(void** slot, Node* node, unsigned char byte, void* child) {
+    switch (node->type) {
+    case kNode4:
+    case kNode16: {
+        // both keep their key bytes sorted and differ only in capacity
+        unsigned capacity = node->type == kNode4 ? 4 : 16;
+        unsigned char* keys = node->type == kNode4 ? static_cast<Node4*>(node)->keys : static_cast<Node16*>(node)->keys;
+        void** children = node->type == kNode4 ? static_cast<Node4*>(node)->children : static_cast<Node16*>(node)->children;
+        if (node->count == capacity) {
+            Node* grown = newNode(node->type == kNode4 ? kNode16 : kNode48);
+            copyHeader(grown, node);
+            for (unsigned i = 0; i < node->count; ++i) {
+                addChild(slot, grown, keys[i], children[i]);
+            }
+            addChild(slot, grown, byte, child);
+            *slot = grown;
+            deleteNode(node);
+            return;
+        }
+        unsigned position = 0;
+        while (position < node->count && keys[position] < byte) {
+            ++position;
+        }
+        std::memmove(keys + position + 1, keys + position, node->count - position);
+        std::memmove(children + position + 1, children + position, (node->count - position) * sizeof(void*));
+        keys[position] = byte;
+        children[position] = child;
+        ++node->count;
+        return;
+    }
+    case kNode48: {
+        Node48* node48 = static_cast<Node48*>(node);
+        if (node->count == 48) {
+            Node256* grown = static_cast<Node256*>(newNode(kNode256));
+            copyHeader(grown, node);
+            for (unsigned b = 0; b < 256; ++b) {
+                if (node48->index[b]) {
+                    grown->children[b] = node48->children[node48->index[b] - 1];
+                }
+            }
+            grown->count = node->count;
+            addChild(slot, grown, byte, child);
+            *slot = grown;
+            deleteNode(node);
+            return;
+        }
+        unsigned free_slot = 0;
+        while (node48->children[free_slot]) {
+            ++free_slot;
+        }
+        node48->children[free_slot] = child;
+        node48->index[byte] = free_slot + 1;
+        ++node->count;
+        return;
+    }
+    default:
+        static_cast<Node256*>(node)->children[byte] = child;
+        ++node->count;
+        return;
+    }
+}
+
+template <typename K, typename T>
+void AdaptiveRadixTree<K, T>::removeChild(void** slot, Node* node, unsigned char byte) {
+    switch (node->type) {
+    case kNode4:
+    case kNode16: {
+        unsigned char* keys = node->type == kNode4 ? static_cast<Node4*>(node)->keys : static_cast<Node16*>(node)->keys;
+        void** children = node->type == kNode4 ? static_cast<Node4*>(node)->children : static_cast<Node16*>(node)->children;
+        unsigned position = 0;
+        while (keys[position] != byte) {
+            ++position;
+        }
+        std::memmove(keys + position, keys + position + 1, node->count - position - 1);
+        std::memmove(children + position, children + position + 1, (node->count - position - 1) * sizeof(void*));
+        break;
+    }
+    case kNode48: {
+        Node48* node48 = static_cast<Node48*>(node);
+        node48->children[node48->index[byte] - 1] = nullptr;
+        node48->index[byte] = 0;
+        break;
+    }
+    default:
+        static_cast<Node256*>(node)->children[byte] = nullptr;
+        break;
+    }
+    --node->count;
+    shrink(slot, node);
+}
+
+template <typename K, typename T>
+void AdaptiveRadixTree<K, T>::shrink(void** slot, Node* node) {
+    switch (node->type) {
+    case kNode4: {
+        Node4* node4 = static_cast<Node4*>(node);
+        if (node->count == 0 && node->terminal) {
+            *slot = leafRef(node->terminal);
+            deleteNode(node);
+        } else if (node->count == 1 && !node->terminal) {
+            // a single path needs no branching; fold this node into its child
+            void* child = node4->children[0];
+            if (!isLeaf(child)) {
+                Node* inner = static_cast<Node*>(child);
+                unsigned char prefix[2 * kMaxPrefix + 1];
+                size_t stored = node->prefix_length < kMaxPrefix ? node->prefix_length : kMaxPrefix;
+                size_t inner_stored = inner->prefix_length < kMaxPrefix ? inner->prefix_length : kMaxPrefix;
+                std::memcpy(prefix, node->prefix, stored);
+                prefix[stored] = node4->keys[0];
+                std::memcpy(prefix + stored + 1, inner->prefix, inner_stored);
+                std::memcpy(inner->prefix, prefix, kMaxPrefix);
+                inner->prefix_length += node->prefix_length + 1;
+            }
+            *slot = child;
+            deleteNode(node);
+        }
+        return;
+    }
+    case kNode16: {
+        if (node->count > 3) {
+            return;
+        }
+        Node16* node16 = static_cast<Node16*>(node);
+        Node* shrunk = newNode(kNode4);
+        copyHeader(shrunk, node);
+        for (unsigned i = 0; i < node->count; ++i) {
+            addChild(slot, shrunk, node16->keys[i], node16->children[i]);
+        }
+        *slot = shrunk;
+        deleteNode(node);
+        return;
+    }
+    case kNode48: {
+        if (node->count > 12) {
+            return;
+        }
+        Node48* node48 = static_cast<Node48*>(node);
+        Node* shrunk = newNode(kNode16);
+        copyHeader(shrunk, node);
+        for (unsigned b = 0; b < 256; ++b) {
+            if (node48->index[b]) {
+                addChild(slot, shrunk, b, node48->children[node48->index[b] - 1]);
+            }
+        }
+        *slot = shrunk;
+        deleteNode(node);
+        return;
+    }
+    default: {
+        if (node->count > 37) {
+            return;
+        }
+        Node256* node256 = static_cast<Node256*>(node);
+        Node* shrunk = newNode(kNode48);
+        copyHeader(shrunk, node);
+        for (unsigned b = 0; b < 256; ++b) {
+            if (node256->children[b]) {
+                addChild(slot, shrunk, b, node256->children[b]);
+            }
+        }
+        *slot = shrunk;
+        deleteNode(node);
+        return;
+    }
+    }
+}
+
+template <typename K, typename T>
+void AdaptiveRadixTree<K, T>::copyHeader(Node* to, const Node* from) {
+    to->prefix_length = from->prefix_length;
+    std::memcpy(to->prefix, from->prefix, kMaxPrefix);
+    to->terminal = from->terminal;
+}
+
+template <typename K, typename T>
+void AdaptiveRadixTree<K, T>::setPrefix(Node* node, const std::string& key, size_t depth, size_t length) {
+    node->prefix_length = length;
+    std::memcpy(node->prefix, key.data() + depth, length < kMaxPrefix ? length : kMaxPrefix);
+}
+
+template <typename K, typename T>
+size_t AdaptiveRadixTree<K, T>::prefixMismatch(Node* node, const std::string& key, size_t depth) {
+    size_t limit = key.size() - depth < node->prefix_length ? key.size() - depth : node->prefix_length;
+    size_t stored = limit < kMaxPrefix ? limit : kMaxPrefix;
+    for (size_t i = 0; i < stored; ++i) {
+        if (node->prefix[i] != static_cast<unsigned char>(key[depth + i])) {
+            return i;
+        }
+    }
+    if (limit > kMaxPrefix) {
+        // the rest of the prefix is only recorded in the keys below
+        const std::string& full = KeyBytes<K>::bytes(minimumLeaf(node)->key);
+        for (size_t i = kMaxPrefix; i < limit; ++i) {
+            if (full[depth + i] != key[depth + i]) {
+                return i;
+            }
+        }
+    }
+    return limit;
+}
+
+template <typename K, typename T>
+typename AdaptiveRadixTree<K, T>::Leaf* AdaptiveRadixTree<K, T>::minimumLeaf(void* ref) {
+    while (!isLeaf(ref)) {
+        Node* node = static_cast<Node*>(ref);
+        if (node->terminal) {
+            return node->terminal;
+        }
+        switch (node->type) {
+        case kNode4: ref = static_cast<Node4*>(node)->children[0]; break;
+        case kNode16: ref = static_cast<Node16*>(node)->children[0]; break;
+        case kNode48: {
+            Node48* node48 = static_cast<Node48*>(node);
+            unsigned b = 0;
+            while (!node48->index[b]) {
+                ++b;
+            }
+            ref = node48->children[node48->index[b] - 1];
+            break;
+        }
+        default: {
+            Node256* node256 = static_cast<Node256*>(node);
+            unsigned b = 0;
+            while (!node256->children[b]) {
+                ++b;
+            }
+            ref = node256->children[b];
+            break;
+        }
+        }
+    }
+    return asLeaf(ref);
+}
+
+template <typename K, typename T>
+template <typename F>
+void AdaptiveRadixTree<K, T>::visit(void* ref, F& fn) {
+    if (isLeaf(ref)) {
+        Leaf* leaf = asLeaf(ref);
+        fn(static_cast<const K&>(leaf->key), leaf->value);
+        return;
+    }
+    Node* node = static_cast<Node*>(ref);
+    if (node->terminal) {
+        fn(static_cast<const K&>(node->terminal->key), node->terminal->value);
+    }
+    switch (node->type) {
+    case kNode4:
+        for (unsigned i = 0; i < node->count; ++i) {
+            visit(static_cast<Node4*>(node)->children[i], fn);
+        }
+        break;
+    case kNode16:
+        for (unsigned i = 0; i < node->count; ++i) {
+            visit(static_cast<Node16*>(node)->children[i], fn);
+        }
+        break;
+    case kNode48: {
+        Node48* node48 = static_cast<Node48*>(node);
+        for (unsigned b = 0; b < 256; ++b) {
+            if (node48->index[b]) {
+                visit(node48->children[node48->index[b] - 1], fn);
+            }
+        }
+        break;
+    }
+    default:
+        for (unsigned b = 0; b < 256; ++b) {
+            if (static_cast<Node256*>(node)->children[b]) {
+                visit(static_cast<Node256*>(node)->children[b], fn);
+            }
+        }
+        break;
+    }
+}
+
+template <typename K, typename T>
+void AdaptiveRadixTree<K, T>::destroy(void* ref) {
+    if (isLeaf(ref)) {
+        delete asLeaf(ref);
+        return;
+    }
+    Node* node = static_cast<Node*>(ref);
+    delete node->terminal;
+    switch (node->type) {
+    case kNode4:
+        for (unsigned i = 0; i < node->count; ++i) {
+            destroy(static_cast<Node4*>(node)->children[i]);
+        }
+        break;
+    case kNode16:
+        for (unsigned i = 0; i < node->count; ++i) {
+            destroy(static_cast<Node16*>(node)->children[i]);
+        }
+        break;
+    case kNode48: {
+        Node48* node48 = static_cast<Node48*>(node);
+        for (unsigned i = 0; i < 48; ++i) {
+            if (node48->children[i]) {
+                destroy(node48->children[i]);
+            }
+        }
+        break;
+    }
+    default:
+        for (unsigned b = 0; b < 256; ++b) {
+            if (static_cast<Node256*>(node)->children[b]) {
+                destroy(static_cast<Node256*>(node)->children[b]);
+            }
+        }
+        break;
+    }
+    deleteNode(node);
+}
+
+#endif // __ADAPTIVE_RADIX_TREE__
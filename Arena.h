@@ -0,0 +1,184 @@
+//
+// Arena.h
+//
+// A block allocator handing out fixed size slots for objects of a
+// single type. Memory is obtained in geometrically growing blocks and
+// returned to the system a whole block at a time.
+//
+//
+
+#ifndef __ARENA__
+#define __ARENA__
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+using std::vector;
+
+/** Allocator for objects of type T carved out of large blocks. */
+template <typename T>
+class Arena {
+public:
+    /** Objects still alive are freed, without running their destructors, when the arena is destroyed. */
+    static const bool kReleasesOnDestruction = true;
+
+    /** Constructor. No memory is allocated until the first object is created. */
+    Arena();
+
+    /** Move constructor. The moved-from arena is left empty. */
+    Arena(Arena&& other) noexcept;
+
+    Arena(const Arena& other) = delete;
+
+    /**
+     * Destructor. Frees every block without running destructors of objects
+     * still alive in the arena; callers destroy those first if they need to.
+     */
+    ~Arena();
+
+    /** Move assignment. Frees the blocks currently held and takes ownership of other's. */
+    Arena& operator=(Arena&& other) noexcept;
+
+    Arena& operator=(const Arena& other) = delete;
+
+    /** Exchanges the blocks held by this arena with other in constant time. */
+    void swap(Arena& other) noexcept;
+
+    /** Default constructs a new object in the arena and returns it. */
+    T* create();
+
+    /** Destroys obj and makes its slot available to later calls to create. */
+    void destroy(T* obj);
+
+    /** Frees every block without running destructors of objects still alive in the arena. */
+    void release() noexcept;
+
+private:
+    /** Unused slot, linked into the free list. */
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    /** Storage large and aligned enough to hold either a T or a FreeSlot. */
+    union Slot {
+        FreeSlot free_slot;
+        alignas(T) unsigned char object[sizeof(T)];
+    };
+
+    /** Number of slots in the first block. */
+    static const size_t kMinBlockSlots = 16;
+
+    /** Blocks stop growing once they hold this many slots. */
+    static const size_t kMaxBlockSlots = 1 << 16;
+
+    /** Allocates a new block, at least as large as the previous one, and makes it current. */
+    void grow();
+
+    /** Blocks obtained from the system. */
+    vector<Slot*> blocks;
+
+    /** Slot count of the most recently allocated block. */
+    size_t block_slots;
+
+    /** Next never-used slot in the current block. */
+    Slot* cursor;
+
+    /** One past the last slot of the current block. */
+    Slot* block_end;
+
+    /** Slots whose objects have been destroyed. */
+    FreeSlot* free_list;
+};
+
+
+/** Public Method implementations */
+template <typename T>
+Arena<T>::Arena() : block_slots(0), cursor(nullptr), block_end(nullptr), free_list(nullptr) {}
+
+template <typename T>
+Arena<T>::Arena(Arena&& other) noexcept
+    : blocks(std::move(other.blocks)),
+      block_slots(other.block_slots),
+      cursor(other.cursor),
+      block_end(other.block_end),
+      free_list(other.free_list) {
+    other.blocks.clear();
+    other.block_slots = 0;
+    other.cursor = nullptr;
+    other.block_end = nullptr;
+    other.free_list = nullptr;
+}
+
+template <typename T>
+Arena<T>::~Arena() {
+    release();
+}
+
+template <typename T>
+Arena<T>& Arena<T>::operator=(Arena&& other) noexcept {
+    Arena(std::move(other)).swap(*this);
+    return *this;
+}
+
+template <typename T>
+void Arena<T>::swap(Arena& other) noexcept {
+    blocks.swap(other.blocks);
+    std::swap(block_slots, other.block_slots);
+    std::swap(cursor, other.cursor);
+    std::swap(block_end, other.block_end);
+    std::swap(free_list, other.free_list);
+}
+
+template <typename T>
+T* Arena<T>::create() {
+    void* memory;
+    if (free_list) {
+        memory = free_list;
+        free_list = free_list->next;
+    } else {
+        if (cursor == block_end) {
+            grow();
+        }
+        memory = cursor++;
+    }
+    return new (memory) T();
+}
+
+template <typename T>
+void Arena<T>::destroy(T* obj) {
+    obj->~T();
+    FreeSlot* slot = reinterpret_cast<FreeSlot*>(obj);
+    slot->next = free_list;
+    free_list = slot;
+}
+
+template <typename T>
+void Arena<T>::release() noexcept {
+    for (Slot* block : blocks) {
+        ::operator delete(block);
+    }
+    blocks.clear();
+    block_slots = 0;
+    cursor = nullptr;
+    block_end = nullptr;
+    free_list = nullptr;
+}
+
+
+/** Private Method Implementations */
+template <typename T>
+void Arena<T>::grow() {
+    size_t slots = block_slots == 0 ? kMinBlockSlots : block_slots * 2;
+    if (slots > kMaxBlockSlots) {
+        slots = kMaxBlockSlots;
+    }
+    blocks.reserve(blocks.size() + 1);
+    Slot* block = static_cast<Slot*>(::operator new(slots * sizeof(Slot)));
+    blocks.push_back(block);
+    block_slots = slots;
+    cursor = block;
+    block_end = block + slots;
+}
+
+#endif // __ARENA__
@@ -0,0 +1,305 @@
+//
+// ChangeLog.h
+//
+// A bounded, version-indexed log of entries that any number of
+// readers tail independently by version cursor.
+//
+//
+
+#ifndef __CHANGE_LOG__
+#define __CHANGE_LOG__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+using std::deque;
+using std::vector;
+
+/**
+ * Log holding one entry of type T per version. Appends come from a single writer;
+ * readers may live on other threads. All methods are thread-safe.
+ */
+template <typename T>
+class ChangeLog : public std::enable_shared_from_this<ChangeLog<T>> {
+public:
+    /** What happens when the log is full and a reader still needs the oldest entry. */
+    enum Backpressure {
+        /** The log runs over capacity, and waitForRoom() waits until every reader has moved past the extra entries. */
+        kBlockWriters,
+        /** Discard the oldest entry; readers that needed it must resync. */
+        kDropOldest
+    };
+
+    /** Result of reading from the log. */
+    enum ReadStatus {
+        /** An entry was read and the cursor advanced. */
+        kRead,
+        /** The reader has consumed every entry appended so far. */
+        kCaughtUp,
+        /** Entries the reader needs were dropped. See Reader::resync(). */
+        kResync
+    };
+
+    /** A cursor into the log. Readers unregister themselves on destruction. */
+    class Reader {
+    public:
+        /** Constructor. Use ChangeLog::openReader() instead. */
+        Reader(std::shared_ptr<ChangeLog> log, unsigned cursor);
+
+        ~Reader();
+
+        Reader(const Reader& other) = delete;
+        Reader& operator=(const Reader& other) = delete;
+
+        /** Copies the entry at the cursor into entry and advances the cursor if one is available. */
+        ReadStatus next(T& entry);
+
+        /** Like next(), but waits up to timeout for an entry to be appended. */
+        ReadStatus waitNext(T& entry, std::chrono::milliseconds timeout);
+
+        /**
+         * Repositions the reader after it has rebuilt its state from a snapshot
+         * of snapshot_version, so it continues with the following version.
+         */
+        void resync(unsigned snapshot_version);
+
+        /** Returns the version of the next entry this reader will read. */
+        unsigned cursor() const;
+
+    private:
+        friend class ChangeLog;
+
+        std::shared_ptr<ChangeLog> log;
+
+        /** Guarded by log->mutex. */
+        unsigned next_version;
+
+        /** True once the log restarted under the reader, until it resyncs. Guarded by log->mutex. */
+        bool must_resync;
+    };
+
+    /** Constructor. Holds at most capacity entries. The first appended entry is for first_version. */
+    ChangeLog(size_t capacity, Backpressure backpressure, unsigned first_version);
+
+    /** 
+     * Appends the entry for the next version without blocking. A full log drops its 
+     * oldest entry under kDropOldest and runs over capacity under kBlockWriters.
+     */
+    void append(T entry);
+
+    /** 
+     * Under kBlockWriters, waits until readers have consumed enough for the log to hold 
+     * at most capacity entries. Returns straight away otherwise. The writer must not hold 
+     * any lock a reader takes before advancing, or the two deadlock.
+     */
+    void waitForRoom();
+
+    /** Discards every entry and continues with the entry for first_version. Attached readers must resync. */
+    void restart(unsigned first_version);
+
+    /** Returns a reader whose first entry will be the one for version from_version. */
+    std::shared_ptr<Reader> openReader(unsigned from_version);
+
+    /** Returns the version of the oldest entry still held. */
+    unsigned firstVersion();
+
+    /** Returns the version the next appended entry will have. */
+    unsigned endVersion();
+
+private:
+    /** Reads the entry at reader's cursor. Caller holds mutex. */
+    ReadStatus readLocked(Reader& reader, T& entry);
+
+    /** Returns the smallest cursor of readers not needing a resync, or the end version if none. Caller holds mutex. */
+    unsigned minCursorLocked();
+
+    std::mutex mutex;
+
+    /** Signalled when an entry is appended. */
+    std::condition_variable appended;
+
+    /** Signalled when a reader advances or goes away. */
+    std::condition_variable consumed;
+
+    /** Entries for versions first_version to first_version + entries.size() - 1. */
+    deque<T> entries;
+
+    unsigned first_version;
+
+    size_t capacity;
+
+    Backpressure backpressure;
+
+    /** Readers currently attached. */
+    vector<Reader*> readers;
+};
+
+
+/** Public Method implementations */
+template <typename T>
+ChangeLog<T>::ChangeLog(size_t capacity, Backpressure backpressure, unsigned first_version)
+    : first_version(first_version),
+      capacity(capacity == 0 ? 1 : capacity),
+      backpressure(backpressure) {}
+
+template <typename T>
+void ChangeLog<T>::append(T entry) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (entries.size() >= capacity && (minCursorLocked() > first_version || backpressure == kDropOldest)) {
+            entries.pop_front();
+            ++first_version;
+        }
+        entries.push_back(std::move(entry));
+    }
+    appended.notify_all();
+}
+
+template <typename T>
+void ChangeLog<T>::waitForRoom() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (entries.size() > capacity) {
+        if (minCursorLocked() > first_version) {
+            entries.pop_front();
+            ++first_version;
+        } else {
+            consumed.wait(lock);
+        }
+    }
+}
+
+template <typename T>
+void ChangeLog<T>::restart(unsigned first_version) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        this->first_version = first_version;
+        for (Reader* reader : readers) {
+            reader->must_resync = true;
+        }
+    }
+    appended.notify_all();
+}
+
+template <typename T>
+std::shared_ptr<typename ChangeLog<T>::Reader> ChangeLog<T>::openReader(unsigned from_version) {
+    std::shared_ptr<Reader> reader = std::make_shared<Reader>(this->shared_from_this(), from_version);
+    std::lock_guard<std::mutex> lock(mutex);
+    readers.push_back(reader.get());
+    return reader;
+}
+
+template <typename T>
+unsigned ChangeLog<T>::firstVersion() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return first_version;
+}
+
+template <typename T>
+unsigned ChangeLog<T>::endVersion() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return first_version + entries.size();
+}
+
+
+/** Reader Method implementations */
+template <typename T>
+ChangeLog<T>::Reader::Reader(std::shared_ptr<ChangeLog> log, unsigned cursor)
+    : log(std::move(log)), next_version(cursor), must_resync(false) {}
+
+template <typename T>
+ChangeLog<T>::Reader::~Reader() {
+    {
+        std::lock_guard<std::mutex> lock(log->mutex);
+        vector<Reader*>& readers = log->readers;
+        for (size_t i = 0; i < readers.size(); ++i) {
+            if (readers[i] == this) {
+                readers.erase(readers.begin() + i);
+                break;
+            }
+        }
+    }
+    log->consumed.notify_all();
+}
+
+template <typename T>
+typename ChangeLog<T>::ReadStatus ChangeLog<T>::Reader::next(T& entry) {
+    ReadStatus status;
+    {
+        std::lock_guard<std::mutex> lock(log->mutex);
+        status = log->readLocked(*this, entry);
+    }
+    if (status == kRead) {
+        log->consumed.notify_all();
+    }
+    return status;
+}
+
+template <typename T>
+typename ChangeLog<T>::ReadStatus ChangeLog<T>::Reader::waitNext(T& entry, std::chrono::milliseconds timeout) {
+    ReadStatus status;
+    {
+        std::unique_lock<std::mutex> lock(log->mutex);
+        status = log->readLocked(*this, entry);
+        if (status == kCaughtUp) {
+            log->appended.wait_for(lock, timeout, [this]() {
+                return must_resync || next_version != log->first_version + log->entries.size();
+            });
+            status = log->readLocked(*this, entry);
+        }
+    }
+    if (status == kRead) {
+        log->consumed.notify_all();
+    }
+    return status;
+}
+
+template <typename T>
+void ChangeLog<T>::Reader::resync(unsigned snapshot_version) {
+    {
+        std::lock_guard<std::mutex> lock(log->mutex);
+        next_version = snapshot_version + 1;
+        must_resync = false;
+    }
+    log->consumed.notify_all();
+}
+
+template <typename T>
+unsigned ChangeLog<T>::Reader::cursor() const {
+    std::lock_guard<std::mutex> lock(log->mutex);
+    return next_version;
+}
+
+
+/** Private Method Implementations */
+template <typename T>
+typename ChangeLog<T>::ReadStatus ChangeLog<T>::readLocked(Reader& reader, T& entry) {
+    if (reader.must_resync || reader.next_version < first_version) {
+        return kResync;
+    }
+    if (reader.next_version >= first_version + entries.size()) {
+        return kCaughtUp;
+    }
+    entry = entries[reader.next_version - first_version];
+    ++reader.next_version;
+    return kRead;
+}
+
+template <typename T>
+unsigned ChangeLog<T>::minCursorLocked() {
+    unsigned min_cursor = first_version + entries.size();
+    for (Reader* reader : readers) {
+        // readers behind first_version must resync and no longer hold entries back
+        if (!reader->must_resync && reader->next_version >= first_version && reader->next_version < min_cursor) {
+            min_cursor = reader->next_version;
+        }
+    }
+    return min_cursor;
+}
+
+#endif // __CHANGE_LOG__
@@ -0,0 +1,172 @@
+//
+// Delta.h
+//
+// Binary delta encoding of one byte string against another. A delta is
+// a sequence of copy operations, taking a run of bytes from the base,
+// and insert operations carrying literal bytes.
+//
+//
+
+#ifndef __DELTA__
+#define __DELTA__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+/** Encoder and decoder for byte string deltas. */
+class DeltaCodec {
+public:
+    /** Returns a delta that rebuilds target from base. */
+    static std::string encode(const std::string& base, const std::string& target);
+
+    /** Rebuilds the target a delta returned by encode() was made from. */
+    static std::string apply(const std::string& base, const std::string& encoded);
+
+private:
+    /** Length of the base blocks that matches are seeded from. */
+    static const size_t kBlockSize = 16;
+
+    /** Appends value to out as a little endian base 128 varint. */
+    static void writeVarint(std::string& out, uint64_t value);
+
+    /** Reads a varint written by writeVarint() at in, advancing in past it. */
+    static uint64_t readVarint(const char*& in);
+
+    /** Hash of the kBlockSize bytes at data, rolled by rollHash(). */
+    static uint64_t blockHash(const char* data);
+
+    /** Slides a blockHash() one byte forward, dropping out and taking in. top is 31^(kBlockSize - 1). */
+    static uint64_t rollHash(uint64_t hash, char out, char in, uint64_t top);
+
+    /** Appends an insert operation for the length bytes at data. */
+    static void emitInsert(std::string& out, const char* data, size_t length);
+
+    /** Appends a copy operation for length bytes of the base starting at offset. */
+    static void emitCopy(std::string& out, size_t offset, size_t length);
+};
+
+
+/** Public Method implementations */
+inline std::string DeltaCodec::encode(const std::string& base, const std::string& target) {
+    std::string out;
+    if (base.size() < kBlockSize || target.size() < kBlockSize) {
+        emitInsert(out, target.data(), target.size());
+        return out;
+    }
+
+    // index the start of every aligned block of the base
+    std::unordered_map<uint64_t, size_t> blocks;
+    blocks.reserve(base.size() / kBlockSize);
+    for (size_t i = 0; i + kBlockSize <= base.size(); i += kBlockSize) {
+        blocks.emplace(blockHash(base.data() + i), i);
+    }
+    uint64_t top = 1;
+    for (size_t i = 1; i < kBlockSize; ++i) {
+        top *= 31;
+    }
+
+    size_t literal_start = 0;
+    size_t position = 0;
+    uint64_t hash = blockHash(target.data());
+    while (position + kBlockSize <= target.size()) {
+        auto match = blocks.find(hash);
+        if (match != blocks.end()
+                && std::memcmp(base.data() + match->second, target.data() + position, kBlockSize) == 0) {
+            size_t base_start = match->second;
+            size_t target_start = position;
+            // grow the match backwards into pending literals, then forwards
+            while (base_start > 0 && target_start > literal_start
+                    && base[base_start - 1] == target[target_start - 1]) {
+                --base_start;
+                --target_start;
+            }
+            size_t length = position + kBlockSize - target_start;
+            while (base_start + length < base.size() && target_start + length < target.size()
+                    && base[base_start + length] == target[target_start + length]) {
+                ++length;
+            }
+            emitInsert(out, target.data() + literal_start, target_start - literal_start);
+            emitCopy(out, base_start, length);
+            position = target_start + length;
+            literal_start = position;
+            if (position + kBlockSize <= target.size()) {
+                hash = blockHash(target.data() + position);
+            }
+            continue;
+        }
+        if (position + kBlockSize < target.size()) {
+            hash = rollHash(hash, target[position], target[position + kBlockSize], top);
+        }
+        ++position;
+    }
+    emitInsert(out, target.data() + literal_start, target.size() - literal_start);
+    return out;
+}
+
+inline std::string DeltaCodec::apply(const std::string& base, const std::string& encoded) {
+    std::string target;
+    const char* in = encoded.data();
+    const char* end = in + encoded.size();
+    while (in < end) {
+        uint64_t header = readVarint(in);
+        size_t length = header >> 1;
+        if (header & 1) {
+            size_t offset = readVarint(in);
+            target.append(base, offset, length);
+        } else {
+            target.append(in, length);
+            in += length;
+        }
+    }
+    return target;
+}
+
+
+/** Private Method Implementations */
+inline void DeltaCodec::writeVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline uint64_t DeltaCodec::readVarint(const char*& in) {
+    uint64_t value = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*in++);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+inline uint64_t DeltaCodec::blockHash(const char* data) {
+    uint64_t hash = 0;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        hash = hash * 31 + static_cast<uint8_t>(data[i]);
+    }
+    return hash;
+}
+
+inline uint64_t DeltaCodec::rollHash(uint64_t hash, char out, char in, uint64_t top) {
+    return (hash - static_cast<uint8_t>(out) * top) * 31 + static_cast<uint8_t>(in);
+}
+
+inline void DeltaCodec::emitInsert(std::string& out, const char* data, size_t length) {
+    if (length > 0) {
+        writeVarint(out, static_cast<uint64_t>(length) << 1);
+        out.append(data, length);
+    }
+}
+
+inline void DeltaCodec::emitCopy(std::string& out, size_t offset, size_t length) {
+    writeVarint(out, (static_cast<uint64_t>(length) << 1) | 1);
+    writeVarint(out, offset);
+}
+
+#endif // __DELTA__
@@ -0,0 +1,218 @@
+//
+// DenseIndex.h
+//
+// Key index for integer keys drawn densely from 0 upwards, such as entity
+// ids. A key's value is found by indexing an array instead of hashing:
+// the high bits of the key pick a page and the low bits a slot in it.
+// Pages are allocated as keys reach them, so growing never moves the
+// values already held, and freed once their last key is erased.
+//
+//
+
+#ifndef __DENSE_INDEX__
+#define __DENSE_INDEX__
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+using std::vector;
+
+/**
+ * Directly indexed key index implementing the interface of KeyIndex.h. Keys must be
+ * non-negative; memory is proportional to the largest key, in pages of 2^kPageBits slots.
+ */
+template <typename K, typename T, unsigned kPageBits = 8>
+class DenseIndex {
+    static_assert(std::is_integral<K>::value, "DenseIndex keys must be integers");
+
+public:
+    DenseIndex();
+
+    DenseIndex(DenseIndex&& other) noexcept;
+
+    DenseIndex(const DenseIndex& other) = delete;
+
+    ~DenseIndex();
+
+    DenseIndex& operator=(DenseIndex&& other) noexcept;
+
+    DenseIndex& operator=(const DenseIndex& other) = delete;
+
+    /** Returns the value mapped to key, or nullptr if there is none. */
+    T* find(const K& key);
+
+    /** Returns the value mapped to key, inserting a default constructed one if there is none. */
+    T& operator[](const K& key);
+
+    /** Removes key. Returns true if it was present. */
+    bool erase(const K& key);
+
+    /** Calls fn(key, value) for every key in ascending order. fn must not insert or erase keys. */
+    template <typename F>
+    void forEach(F fn);
+
+    /** Returns the number of keys. */
+    size_t size() const;
+
+    /** Removes every key. */
+    void clear() noexcept;
+
+    /** Exchanges the contents of this index with other in constant time. */
+    void swap(DenseIndex& other) noexcept;
+
+private:
+    static const size_t kPageSize = size_t(1) << kPageBits;
+
+    struct Page {
+        Page() : count(0), present(), values() {}
+
+        /** Number of keys present in the page. */
+        size_t count;
+
+        /** Bit per slot, set if the slot holds a key. */
+        uint64_t present[(kPageSize + 63) / 64];
+
+        T values[kPageSize];
+    };
+
+    /** Returns key as an index into the slots of every page. */
+    static size_t slotOf(const K& key);
+
+    static bool isPresent(const Page* page, size_t offset);
+
+    /** Pages in key order, nullptr where no key of the page is present. */
+    vector<Page*> pages;
+
+    size_t count;
+};
+
+
+/** Public Method implementations */
+template <typename K, typename T, unsigned kPageBits>
+DenseIndex<K, T, kPageBits>::DenseIndex() : count(0) {}
+
+template <typename K, typename T, unsigned kPageBits>
+DenseIndex<K, T, kPageBits>::DenseIndex(DenseIndex&& other) noexcept
+    : pages(std::move(other.pages)), count(other.count) {
+    other.pages.clear();
+    other.count = 0;
+}
+
+template <typename K, typename T, unsigned kPageBits>
+DenseIndex<K, T, kPageBits>::~DenseIndex() {
+    clear();
+}
+
+template <typename K, typename T, unsigned kPageBits>
+DenseIndex<K, T, kPageBits>& DenseIndex<K, T, kPageBits>::operator=(DenseIndex&& other) noexcept {
+    DenseIndex(std::move(other)).swap(*this);
+    return *this;
+}
+
+template <typename K, typename T, unsigned kPageBits>
+T* DenseIndex<K, T, kPageBits>::find(const K& key) {
+    size_t slot = slotOf(key);
+    size_t page_number = slot >> kPageBits;
+    if (page_number >= pages.size() || !pages[page_number]) {
+        return nullptr;
+    }
+    Page* page = pages[page_number];
+    size_t offset = slot & (kPageSize - 1);
+    return isPresent(page, offset) ? &page->values[offset] : nullptr;
+}
+
+template <typename K, typename T, unsigned kPageBits>
+T& DenseIndex<K, T, kPageBits>::operator[](const K& key) {
+    size_t slot = slotOf(key);
+    size_t page_number = slot >> kPageBits;
+    if (page_number >= pages.size()) {
+        pages.resize(page_number + 1, nullptr);
+    }
+    if (!pages[page_number]) {
+        pages[page_number] = new Page();
+    }
+    Page* page = pages[page_number];
+    size_t offset = slot & (kPageSize - 1);
+    if (!isPresent(page, offset)) {
+        page->present[offset / 64] |= uint64_t(1) << (offset % 64);
+        ++page->count;
+        ++count;
+    }
+    return page->values[offset];
+}
+
+template <typename K, typename T, unsigned kPageBits>
+bool DenseIndex<K, T, kPageBits>::erase(const K& key) {
+    size_t slot = slotOf(key);
+    size_t page_number = slot >> kPageBits;
+    if (page_number >= pages.size() || !pages[page_number]) {
+        return false;
+    }
+    Page* page = pages[page_number];
+    size_t offset = slot & (kPageSize - 1);
+    if (!isPresent(page, offset)) {
+        return false;
+    }
+    --count;
+    if (--page->count == 0) {
+        delete page;
+        pages[page_number] = nullptr;
+        return true;
+    }
+    page->present[offset / 64] &= ~(uint64_t(1) << (offset % 64));
+    page->values[offset] = T();
+    return true;
+}
+
+template <typename K, typename T, unsigned kPageBits>
+template <typename F>
+void DenseIndex<K, T, kPageBits>::forEach(F fn) {
+    for (size_t page_number = 0; page_number < pages.size(); ++page_number) {
+        Page* page = pages[page_number];
+        if (!page) {
+            continue;
+        }
+        for (size_t offset = 0; offset < kPageSize; ++offset) {
+            if (isPresent(page, offset)) {
+                const K key = static_cast<K>((page_number << kPageBits) | offset);
+                fn(key, page->values[offset]);
+            }
+        }
+    }
+}
+
+template <typename K, typename T, unsigned kPageBits>
+size_t DenseIndex<K, T, kPageBits>::size() const {
+    return count;
+}
+
+template <typename K, typename T, unsigned kPageBits>
+void DenseIndex<K, T, kPageBits>::clear() noexcept {
+    for (Page* page : pages) {
+        delete page;
+    }
+    pages.clear();
+    count = 0;
+}
+
+template <typename K, typename T, unsigned kPageBits>
+void DenseIndex<K, T, kPageBits>::swap(DenseIndex& other) noexcept {
+    pages.swap(other.pages);
+    std::swap(count, other.count);
+}
+
+
+/** Private Method Implementations */
+template <typename K, typename T, unsigned kPageBits>
+size_t DenseIndex<K, T, kPageBits>::slotOf(const K& key) {
+    return static_cast<size_t>(static_cast<typename std::make_unsigned<K>::type>(key));
+}
+
+template <typename K, typename T, unsigned kPageBits>
+bool DenseIndex<K, T, kPageBits>::isPresent(const Page* page, size_t offset) {
+    return (page->present[offset / 64] >> (offset % 64)) & 1;
+}
+
+#endif // __DENSE_INDEX__
@@ -0,0 +1,273 @@
+//
+// FastHash.h
+//
+// High throughput hash for key indexes, after wyhash for short inputs
+// and XXH3 for long ones. Inputs up to 1KB are folded through 64 x 64 ->
+// 128 bit multiplies, three independent chains of them from 48 bytes on;
+// longer inputs feed 64 byte stripes into eight accumulators, four per
+// AVX2 or two per SSE2 register where available. The scalar, SSE2 and
+// AVX2 paths compute the same hash.
+//
+//
+
+#ifndef __FAST_HASH__
+#define __FAST_HASH__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if !defined(__SIZEOF_INT128__) && defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+/** 
+ * Hash functor usable wherever std::hash is. Strings are hashed by hashBytes(); other 
+ * keys hash to their std::hash value, mixed so every bit depends on every input bit.
+ */
+struct FastHash {
+    size_t operator()(const std::string& key) const {
+        return static_cast<size_t>(hashBytes(key.data(), key.size(), 0));
+    }
+
+    template <typename K>
+    size_t operator()(const K& key) const {
+        return static_cast<size_t>(mix(static_cast<uint64_t>(std::hash<K>()(key)), kPrimes[0]));
+    }
+
+    /** Returns the 64 bit hash of the length bytes at data. */
+    static uint64_t hashBytes(const void* data, size_t length, uint64_t seed);
+
+private:
+    static constexpr uint64_t kPrimes[4] = {
+        0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL
+    };
+
+    /** 
+     * Inputs longer than this take the striped loop. Below it the multiply chains are 
+     * faster, the SIMD loop only pulling ahead with AVX2 and long inputs.
+     */
+    static constexpr size_t kLongInput = 1024;
+
+    /** Accumulators of the long input loop; one stripe feeds each 8 bytes. */
+    static constexpr size_t kLanes = 8;
+
+    static constexpr size_t kStripe = kLanes * 8;
+
+    /** Stripes between accumulator scrambles. Stripe i of a block is keyed by kSecret[i] onwards. */
+    static constexpr size_t kStripesPerBlock = 16;
+
+    static constexpr size_t kSecretWords = kStripesPerBlock + kLanes;
+
+    /** Key material of the long input loop, from splitmix64 seeded with the digits of pi. */
+    static constexpr uint64_t kSecret[kSecretWords] = {
+        0x2cb0f69f4abea221ULL, 0x9417034723148989ULL, 0xdd555950609dfe03ULL,
+        0xdbafb150deb12800ULL, 0x7e789b2e6c442cb6ULL, 0xf41e5636c7e4f8c4ULL,
+        0x0959d150f8fba7e4ULL, 0xa97316f13cdb9eeaULL, 0x74cd8258f9520068ULL,
+        0x55c74a62e116868bULL, 0xd2f4c799a2023cbdULL, 0xdf98cb79a37b51b9ULL,
+        0x396f5885524f3905ULL, 0xaf1d56386ca3b276ULL, 0xa9ffbe6b5104e85aULL,
+        0x6bd0c51b9fd533b3ULL, 0x980ce91c50ab4b56ULL, 0x28ac395780fe62c5ULL,
+        0x768912e3a6bcedc7ULL, 0x50b3e8c9332c7c88ULL, 0xce3bbfe520bd47daULL,
+        0xcba6c8e8e0bb7c4fULL, 0xbf194db8434a346dULL, 0x7d8f2a7b60416d7fULL
+    };
+
+    static uint64_t read64(const unsigned char* p);
+
+    static uint64_t read32(const unsigned char* p);
+
+    /** Multiplies a by b and folds the 128 bit product to 64 bits. */
+    static uint64_t mix(uint64_t a, uint64_t b);
+
+    /** Hashes inputs longer than kLongInput bytes. */
+    static uint64_t hashLong(const unsigned char* p, size_t length, uint64_t seed);
+
+    /** Adds one stripe at p, keyed by secret, to the accumulators. */
+    static void accumulate(uint64_t* acc, const unsigned char* p, const uint64_t* secret);
+
+    /** Spreads the high bits of every accumulator into its low bits. */
+    static void scramble(uint64_t* acc);
+};
+
+/** Public Method implementations */
+inline uint64_t FastHash::hashBytes(const void* data, size_t length, uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    if (length > kLongInput) {
+        return hashLong(p, length, seed);
+    }
+    seed ^= kPrimes[0];
+    uint64_t a;
+    uint64_t b;
+    if (length <= 16) {
+        if (length >= 4) {
+            // two overlapping reads from each end cover every byte
+            size_t offset = (length >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + offset);
+            b = (read32(p + length - 4) << 32) | read32(p + length - 4 - offset);
+        } else if (length > 0) {
+            a = (uint64_t(p[0]) << 16) | (uint64_t(p[length >> 1]) << 8) | p[length - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t remaining = length;
+        const unsigned char* q = p;
+        if (remaining > 48) {
+            // three independent chains, so their multiplies overlap
+            uint64_t seed1 = seed;
+            uint64_t seed2 = seed;
+            do {
+                seed = mix(read64(q) ^ kPrimes[1], read64(q + 8) ^ seed);
+                seed1 = mix(read64(q + 16) ^ kPrimes[2], read64(q + 24) ^ seed1);
+                seed2 = mix(read64(q + 32) ^ kPrimes[3], read64(q + 40) ^ seed2);
+                q += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while (remaining > 16) {
+            seed = mix(read64(q) ^ kPrimes[1], read64(q + 8) ^ seed);
+            q += 16;
+            remaining -= 16;
+        }
+        a = read64(p + length - 16);
+        b = read64(p + length - 8);
+    }
+    return mix(kPrimes[1] ^ length, mix(a ^ kPrimes[1], b ^ seed));
+}
+
+
+/** Private Method Implementations */
+inline uint64_t FastHash::read64(const unsigned char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t FastHash::read32(const unsigned char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t FastHash::mix(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    // __extension__ keeps -Wpedantic quiet about the non-standard type
+    __extension__ typedef unsigned __int128 Product;
+    Product product = static_cast<Product>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t high;
+    uint64_t low = _umul128(a, b, &high);
+    return low ^ high;
+#else
+    uint64_t a_high = a >> 32, a_low = static_cast<uint32_t>(a);
+    uint64_t b_high = b >> 32, b_low = static_cast<uint32_t>(b);
+    uint64_t high_high = a_high * b_high, high_low = a_high * b_low;
+    uint64_t low_high = a_low * b_high, low_low = a_low * b_low;
+    uint64_t middle = (low_low >> 32) + static_cast<uint32_t>(high_low) + static_cast<uint32_t>(low_high);
+    uint64_t low = (middle << 32) | static_cast<uint32_t>(low_low);
+    uint64_t high = high_high + (high_low >> 32) + (low_high >> 32) + (middle >> 32);
+    return low ^ high;
+#endif
+}
+
+inline uint64_t FastHash::hashLong(const unsigned char* p, size_t length, uint64_t seed) {
+    uint64_t acc[kLanes];
+    for (size_t lane = 0; lane < kLanes; ++lane) {
+        acc[lane] = kPrimes[lane & 3] ^ seed;
+    }
+    size_t stripes = (length - 1) / kStripe;
+    for (size_t stripe = 0; stripe < stripes; ++stripe) {
+        accumulate(acc, p + stripe * kStripe, kSecret + stripe % kStripesPerBlock);
+        if (stripe % kStripesPerBlock == kStripesPerBlock - 1) {
+            scramble(acc);
+        }
+    }
+    // the last stripe ends at the last byte, overlapping the one before if need be
+    accumulate(acc, p + length - kStripe, kSecret + kStripesPerBlock);
+
+    uint64_t hash = length * kPrimes[0];
+    for (size_t lane = 0; lane < kLanes; lane += 2) {
+        hash += mix(acc[lane] ^ kSecret[lane], acc[lane + 1] ^ kSecret[lane + 1]);
+    }
+    hash ^= hash >> 37;
+    hash *= kPrimes[2];
+    return hash ^ (hash >> 32);
+}
+
+inline void FastHash::accumulate(uint64_t* acc, const unsigned char* p, const uint64_t* secret) {
+    // each lane adds the product of the halves of data ^ secret, and its neighbour adds data itself
+#if defined(__AVX2__)
+    for (size_t lane = 0; lane < kLanes; lane += 4) {
+        __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + lane * 8));
+        __m256i key = _mm256_xor_si256(data, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret + lane)));
+        __m256i product = _mm256_mul_epu32(key, _mm256_srli_epi64(key, 32));
+        __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        __m256i sum = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + lane)),
+                                       _mm256_add_epi64(product, swapped));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + lane), sum);
+    }
+#elif defined(__SSE2__)
+    for (size_t lane = 0; lane < kLanes; lane += 2) {
+        __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + lane * 8));
+        __m128i key = _mm_xor_si128(data, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret + lane)));
+        __m128i product = _mm_mul_epu32(key, _mm_srli_epi64(key, 32));
+        __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+        __m128i sum = _mm_add_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + lane)),
+                                    _mm_add_epi64(product, swapped));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + lane), sum);
+    }
+#else
+    for (size_t lane = 0; lane < kLanes; ++lane) {
+        uint64_t data = read64(p + lane * 8);
+        uint64_t key = data ^ secret[lane];
+        acc[lane ^ 1] += data;
+        acc[lane] += static_cast<uint32_t>(key) * (key >> 32);
+    }
+#endif
+}
+
+inline void FastHash::scramble(uint64_t* acc) {
+    const uint32_t multiplier = static_cast<uint32_t>(kPrimes[3]);
+#if defined(__AVX2__)
+    __m256i prime = _mm256_set1_epi32(static_cast<int>(multiplier));
+    for (size_t lane = 0; lane < kLanes; lane += 4) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + lane));
+        value = _mm256_xor_si256(value, _mm256_srli_epi64(value, 47));
+        value = _mm256_xor_si256(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kSecret + kStripesPerBlock - kLanes + lane)));
+        __m256i low = _mm256_mul_epu32(value, prime);
+        __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(value, 32), prime);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + lane), _mm256_add_epi64(low, _mm256_slli_epi64(high, 32)));
+    }
+#elif defined(__SSE2__)
+    __m128i prime = _mm_set1_epi32(static_cast<int>(multiplier));
+    for (size_t lane = 0; lane < kLanes; lane += 2) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + lane));
+        value = _mm_xor_si128(value, _mm_srli_epi64(value, 47));
+        value = _mm_xor_si128(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(kSecret + kStripesPerBlock - kLanes + lane)));
+        // SSE2 has no 64 bit multiply; a 32 bit multiplier splits into two 32 x 32 products
+        __m128i low = _mm_mul_epu32(value, prime);
+        __m128i high = _mm_mul_epu32(_mm_srli_epi64(value, 32), prime);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + lane), _mm_add_epi64(low, _mm_slli_epi64(high, 32)));
+    }
+#else
+    for (size_t lane = 0; lane < kLanes; ++lane) {
+        uint64_t value = acc[lane];
+        value ^= value >> 47;
+        value ^= kSecret[kStripesPerBlock - kLanes + lane];
+        acc[lane] = value * multiplier;
+    }
+#endif
+}
+
+#endif // __FAST_HASH__
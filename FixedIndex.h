@@ -0,0 +1,227 @@
+//
+// FixedIndex.h
+//
+// Key index holding at most kCapacity keys in storage inside the index
+// itself, so it never allocates. Keys and values live in a fixed array
+// of slots; a separate open addressing table of slot numbers, twice as
+// large, finds them by linear probing. Nothing is ever rehashed into new
+// memory, so mapped values never move.
+//
+//
+
+#ifndef __FIXED_INDEX__
+#define __FIXED_INDEX__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+/**
+ * Fixed capacity key index implementing the interface of KeyIndex.h, except that it can
+ * be neither moved nor swapped. Inserting into a full index is not allowed; callers check
+ * size() against kCapacity first.
+ */
+template <typename K, typename T, size_t kCapacity, typename Hash = std::hash<K>>
+class FixedIndex {
+public:
+    FixedIndex();
+
+    FixedIndex(const FixedIndex& other) = delete;
+
+    FixedIndex& operator=(const FixedIndex& other) = delete;
+
+    /** Returns the value mapped to key, or nullptr if there is none. */
+    T* find(const K& key);
+
+    /** Returns the value mapped to key, inserting a default constructed one if there is none. */
+    T& operator[](const K& key);
+
+    /** Removes key. Returns true if it was present. */
+    bool erase(const K& key);
+
+    /** Calls fn(key, value) for every key. fn must not insert or erase keys. */
+    template <typename F>
+    void forEach(F fn);
+
+    /** Returns the number of keys. */
+    size_t size() const;
+
+    /** Removes every key. */
+    void clear() noexcept;
+
+private:
+    struct Slot {
+        Slot() : used(false), key(), value() {}
+
+        bool used;
+
+        K key;
+
+        T value;
+    };
+
+    /** Entries of table: 0 is empty, kErased an erased key, otherwise one more than a slot number. */
+    typedef uint32_t Position;
+
+    static const Position kErased = UINT32_MAX;
+
+    /** Smallest power of two of at least twice the capacity, keeping probe sequences short. */
+    static constexpr size_t tableSize() {
+        size_t size = 1;
+        while (size < kCapacity * 2) {
+            size *= 2;
+        }
+        return size;
+    }
+
+    static const size_t kTableSize = tableSize();
+
+    static size_t hashOf(const K& key);
+
+    /** Returns the table position holding key, or kTableSize if there is none. */
+    size_t findPosition(const K& key) const;
+
+    /** Refills table from the used slots, dropping erased positions. */
+    void rebuild();
+
+    Slot slots[kCapacity];
+
+    Position table[kTableSize];
+
+    /** Slots from next_unused on have never been used. */
+    size_t next_unused;
+
+    /** Slot numbers of erased keys, reused first. */
+    Position free_slots[kCapacity];
+
+    size_t free_count;
+
+    size_t count;
+
+    /** Positions of table holding kErased. */
+    size_t erased_positions;
+};
+
+
+/** Public Method implementations */
+template <typename K, typename T, size_t kCapacity, typename Hash>
+FixedIndex<K, T, kCapacity, Hash>::FixedIndex()
+    : table(), next_unused(0), free_count(0), count(0), erased_positions(0) {}
+
+template <typename K, typename T, size_t kCapacity, typename Hash>
+T* FixedIndex<K, T, kCapacity, Hash>::find(const K& key) {
+    size_t position = findPosition(key);
+    return position == kTableSize ? nullptr : &slots[table[position] - 1].value;
+}
+
+template <typename K, typename T, size_t kCapacity, typename Hash>
+T& FixedIndex<K, T, kCapacity, Hash>::operator[](const K& key) {
+    size_t position = findPosition(key);
+    if (position != kTableSize) {
+        return slots[table[position] - 1].value;
+    }
+    if (erased_positions + count >= kTableSize * 3 / 4) {
+        // erased positions only lengthen probes; clear them out in place
+        rebuild();
+    }
+    size_t slot = free_count > 0 ? free_slots[--free_count] : next_unused++;
+    slots[slot].used = true;
+    slots[slot].key = key;
+    position = hashOf(key) & (kTableSize - 1);
+    while (table[position] != 0 && table[position] != kErased) {
+        position = (position + 1) & (kTableSize - 1);
+    }
+    if (table[position] == kErased) {
+        --erased_positions;
+    }
+    table[position] = static_cast<Position>(slot + 1);
+    ++count;
+    return slots[slot].value;
+}
+
+template <typename K, typename T, size_t kCapacity, typename Hash>
+bool FixedIndex<K, T, kCapacity, Hash>::erase(const K& key) {
+    size_t position = findPosition(key);
+    if (position == kTableSize) {
+        return false;
+    }
+    size_t slot = table[position] - 1;
+    slots[slot].used = false;
+    slots[slot].key = K();
+    slots[slot].value = T();
+    free_slots[free_count++] = static_cast<Position>(slot);
+    table[position] = kErased;
+    ++erased_positions;
+    --count;
+    return true;
+}
+
+template <typename K, typename T, size_t kCapacity, typename Hash>
+template <typename F>
+void FixedIndex<K, T, kCapacity, Hash>::forEach(F fn) {
+    for (size_t slot = 0; slot < next_unused; ++slot) {
+        if (slots[slot].used) {
+            fn(static_cast<const K&>(slots[slot].key), slots[slot].value);
+        }
+    }
+}
+
+template <typename K, typename T, size_t kCapacity, typename Hash>
+size_t FixedIndex<K, T, kCapacity, Hash>::size() const {
+    return count;
+}
+
+template <typename K, typename T, size_t kCapacity, typename Hash>
+void FixedIndex<K, T, kCapacity, Hash>::clear() noexcept {
+    for (size_t slot = 0; slot < next_unused; ++slot) {
+        slots[slot] = Slot();
+    }
+    for (size_t position = 0; position < kTableSize; ++position) {
+        table[position] = 0;
+    }
+    next_unused = 0;
+    free_count = 0;
+    count = 0;
+    erased_positions = 0;
+}
+
+
+/** Private Method Implementations */
+template <typename K, typename T, size_t kCapacity, typename Hash>
+size_t FixedIndex<K, T, kCapacity, Hash>::hashOf(const K& key) {
+    uint64_t hash = static_cast<uint64_t>(Hash()(key));
+    // std::hash of an integer is the integer itself; spread it over every bit
+    hash *= 0x9E3779B97F4A7C15ULL;
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+template <typename K, typename T, size_t kCapacity, typename Hash>
+size_t FixedIndex<K, T, kCapacity, Hash>::findPosition(const K& key) const {
+    size_t position = hashOf(key) & (kTableSize - 1);
+    while (table[position] != 0) {
+        if (table[position] != kErased && slots[table[position] - 1].key == key) {
+            return position;
+        }
+        position = (position + 1) & (kTableSize - 1);
+    }
+    return kTableSize;
+}
+
+template <typename K, typename T, size_t kCapacity, typename Hash>
+void FixedIndex<K, T, kCapacity, Hash>::rebuild() {
+    for (size_t position = 0; position < kTableSize; ++position) {
+        table[position] = 0;
+    }
+    for (size_t slot = 0; slot < next_unused; ++slot) {
+        if (slots[slot].used) {
+            size_t position = hashOf(slots[slot].key) & (kTableSize - 1);
+            while (table[position] != 0) {
+                position = (position + 1) & (kTableSize - 1);
+            }
+            table[position] = static_cast<Position>(slot + 1);
+        }
+    }
+    erased_positions = 0;
+}
+
+#endif // __FIXED_INDEX__
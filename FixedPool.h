@@ -0,0 +1,84 @@
+//
+// FixedPool.h
+//
+// Allocator with the Arena interface whose storage for kCapacity
+// objects is part of the pool itself, so creating and destroying
+// objects never reaches the system allocator. create() returns nullptr
+// once every slot is in use.
+//
+//
+
+#ifndef __FIXED_POOL__
+#define __FIXED_POOL__
+
+#include <cstddef>
+#include <new>
+
+/** Pool of kCapacity slots for objects of type T. Can be neither moved nor swapped. */
+template <typename T, size_t kCapacity>
+class FixedPool {
+public:
+    /** The slots are part of the pool, so objects still alive need no freeing on destruction. */
+    static const bool kReleasesOnDestruction = true;
+
+    FixedPool();
+
+    FixedPool(const FixedPool& other) = delete;
+
+    FixedPool& operator=(const FixedPool& other) = delete;
+
+    /** Default constructs a new object in the pool and returns it, or returns nullptr if the pool is full. */
+    T* create();
+
+    /** Destroys obj and makes its slot available to later calls to create. */
+    void destroy(T* obj);
+
+private:
+    /** Unused slot, linked into the free list. */
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    /** Storage large and aligned enough to hold either a T or a FreeSlot. */
+    union Slot {
+        FreeSlot free_slot;
+        alignas(T) unsigned char object[sizeof(T)];
+    };
+
+    Slot slots[kCapacity];
+
+    /** Slots from next_unused on have never been used. */
+    size_t next_unused;
+
+    /** Slots whose objects have been destroyed. */
+    FreeSlot* free_list;
+};
+
+
+/** Public Method implementations */
+template <typename T, size_t kCapacity>
+FixedPool<T, kCapacity>::FixedPool() : next_unused(0), free_list(nullptr) {}
+
+template <typename T, size_t kCapacity>
+T* FixedPool<T, kCapacity>::create() {
+    void* memory;
+    if (free_list) {
+        memory = free_list;
+        free_list = free_list->next;
+    } else if (next_unused < kCapacity) {
+        memory = &slots[next_unused++];
+    } else {
+        return nullptr;
+    }
+    return new (memory) T();
+}
+
+template <typename T, size_t kCapacity>
+void FixedPool<T, kCapacity>::destroy(T* obj) {
+    obj->~T();
+    FreeSlot* slot = reinterpret_cast<FreeSlot*>(obj);
+    slot->next = free_list;
+    free_list = slot;
+}
+
+#endif // __FIXED_POOL__
@@ -0,0 +1,69 @@
+#include "VersionedKvStore.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using namespace std;
+
+/** Bytes currently allocated through operator new, counted by the replacements below. */
+static size_t live_bytes = 0;
+
+/** Room in front of each allocation for its size, kept at the default new alignment. */
+static const size_t kHeader = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+// kept out of line, so the compiler does not pair the malloc and free below with new and delete
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    char* block = static_cast<char*>(malloc(kHeader + size));
+    if (!block) {
+        throw bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    live_bytes += size;
+    return block + kHeader;
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept {
+    if (!pointer) {
+        return;
+    }
+    char* block = static_cast<char*>(pointer) - kHeader;
+    live_bytes -= *reinterpret_cast<size_t*>(block);
+    free(block);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+/** Returns the bytes a heap allocated store holds once keys were set and one version saved. */
+template <typename Store, typename MakeKey>
+size_t footprint(size_t keys, MakeKey make_key) {
+    size_t before = live_bytes;
+    Store* store = new Store();
+    for (size_t key = 0; key < keys; ++key) {
+        store->set(make_key(key), static_cast<int>(key));
+    }
+    store->save();
+    size_t bytes = live_bytes - before;
+    delete store;
+    return bytes;
+}
+
+template <typename Policy>
+void report(const char* name) {
+    auto int_key = [](size_t key) { return static_cast<int>(key); };
+    auto string_key = [](size_t key) { return "key" + to_string(key); };
+    for (size_t keys : {0, 1, 2, 4, 8, 16}) {
+        printf("%-12s %5zu  %10zu %14zu\n", name, keys, footprint<VersionedKvStore<int, int, Policy>>(keys, int_key),
+               footprint<VersionedKvStore<string, int, Policy>>(keys, string_key));
+    }
+}
+
+int main() {
+    printf("%-12s %5s  %10s %14s\n", "policy", "keys", "int bytes", "string bytes");
+    report<DefaultPolicy>("default");
+    report<SmallStore>("small store");
+}
@@ -0,0 +1,77 @@
+#include "FastHash.h"
+#include "SwissTable.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/** Keys of the given length with random bytes. */
+vector<string> makeKeys(size_t count, size_t length) {
+    mt19937_64 rng(length);
+    vector<string> keys(count, string(length, '\0'));
+    for (string& key : keys) {
+        for (char& byte : key) {
+            byte = static_cast<char>(rng());
+        }
+    }
+    return keys;
+}
+
+/** Returns nanoseconds per call of hash over keys, repeated until about 64MB were hashed. */
+template <typename Hash>
+double timeHash(const vector<string>& keys) {
+    Hash hash;
+    size_t rounds = 1 + (64u << 20) / (keys.size() * keys[0].size());
+    size_t sink = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (const string& key : keys) {
+            sink += hash(key);
+        }
+    }
+    double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    // keeps the loop from being optimized away
+    if (sink == 1) {
+        puts("");
+    }
+    return elapsed / (rounds * keys.size());
+}
+
+/** Returns nanoseconds per lookup of every key in a Swiss table hashed by Hash. */
+template <typename Hash>
+double timeLookups(const vector<string>& keys) {
+    SwissTable<string, int, Hash> table;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        table[keys[i]] = static_cast<int>(i);
+    }
+    size_t rounds = 1 + (16u << 20) / (keys.size() * keys[0].size());
+    size_t sink = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (const string& key : keys) {
+            sink += *table.find(key);
+        }
+    }
+    double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    if (sink == 1) {
+        puts("");
+    }
+    return elapsed / (rounds * keys.size());
+}
+
+int main() {
+    printf("%6s  %12s %12s %8s  %12s %12s\n", "bytes", "std::hash ns", "FastHash ns", "GB/s",
+           "find std ns", "find fast ns");
+    for (size_t length = 8; length <= 4096; length *= 2) {
+        vector<string> keys = makeKeys(4096, length);
+        double standard = timeHash<hash<string>>(keys);
+        double fast = timeHash<FastHash>(keys);
+        printf("%6zu  %12.2f %12.2f %8.2f  %12.2f %12.2f\n", length, standard, fast, length / fast,
+               timeLookups<hash<string>>(keys), timeLookups<FastHash>(keys));
+    }
+}
@@ -0,0 +1,109 @@
+//
+// KeyIndex.h
+//
+// Key indexes map keys to per-key state for VersionedKvStore. Every
+// index provides find, operator[], erase, forEach, size, clear and
+// swap, and never moves a mapped value once it has been inserted, other
+// than indexes declaring MovesValues, which may move them whenever keys
+// are inserted or erased.
+// forEach may pass keys as a type K is constructible from rather than
+// as K itself, so callers take them generically.
+// HashIndex is the default, backed by std::unordered_map. Hashed indexes
+// take the hash functor as their last template parameter, e.g.
+// HashIndex<K, T, FastHash>.
+//
+//
+
+#ifndef __KEY_INDEX__
+#define __KEY_INDEX__
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+using std::unordered_map;
+
+/**
+ * True for key indexes that may move mapped values when keys are inserted or erased, such
+ * as indexes packing them into an array. Such indexes declare a static kMovesValues member
+ * set to true.
+ */
+template <typename Index, typename = void>
+struct MovesValues : std::false_type {};
+
+template <typename Index>
+struct MovesValues<Index, std::void_t<decltype(Index::kMovesValues)>>
+    : std::integral_constant<bool, Index::kMovesValues> {};
+
+/** Key index backed by a hash table hashing keys with Hash. */
+template <typename K, typename T, typename Hash = std::hash<K>>
+class HashIndex {
+public:
+    /** Returns the value mapped to key, or nullptr if there is none. */
+    T* find(const K& key);
+
+    /** Returns the value mapped to key, inserting a default constructed one if there is none. */
+    T& operator[](const K& key);
+
+    /** Removes key. Returns true if it was present. */
+    bool erase(const K& key);
+
+    /** Calls fn(key, value) for every key. fn must not insert or erase keys. */
+    template <typename F>
+    void forEach(F fn);
+
+    /** Returns the number of keys. */
+    size_t size() const;
+
+    /** Removes every key. */
+    void clear() noexcept;
+
+    /** Exchanges the contents of this index with other in constant time. */
+    void swap(HashIndex& other) noexcept;
+
+private:
+    unordered_map<K, T, Hash> table;
+};
+
+
+/** Public Method implementations */
+template <typename K, typename T, typename Hash>
+T* HashIndex<K, T, Hash>::find(const K& key) {
+    auto it = table.find(key);
+    return it == table.end() ? nullptr : &it->second;
+}
+
+template <typename K, typename T, typename Hash>
+T& HashIndex<K, T, Hash>::operator[](const K& key) {
+    return table[key];
+}
+
+template <typename K, typename T, typename Hash>
+bool HashIndex<K, T, Hash>::erase(const K& key) {
+    return table.erase(key) > 0;
+}
+
+template <typename K, typename T, typename Hash>
+template <typename F>
+void HashIndex<K, T, Hash>::forEach(F fn) {
+    for (auto it = table.begin(); it != table.end(); ++it) {
+        fn(it->first, it->second);
+    }
+}
+
+template <typename K, typename T, typename Hash>
+size_t HashIndex<K, T, Hash>::size() const {
+    return table.size();
+}
+
+template <typename K, typename T, typename Hash>
+void HashIndex<K, T, Hash>::clear() noexcept {
+    table.clear();
+}
+
+template <typename K, typename T, typename Hash>
+void HashIndex<K, T, Hash>::swap(HashIndex& other) noexcept {
+    table.swap(other.table);
+}
+
+#endif // __KEY_INDEX__
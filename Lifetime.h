@@ -0,0 +1,211 @@
+//
+// Lifetime.h
+//
+// Compact record of the versions in which a key was alive. The versions
+// at which the key was created or erased are kept sorted, so whether it
+// was alive at a version is a binary search. Keys toggled at most
+// kInline times, twice by default, need no allocation.
+//
+//
+
+#ifndef __LIFETIME__
+#define __LIFETIME__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+/** 
+ * Sorted toggle versions; the key is alive from the 1st toggle to the 2nd, 3rd to 4th, and 
+ * so on. Up to kInline toggles are held without allocating.
+ */
+template <uint32_t kInline>
+class BasicLifetime {
+public:
+    /** Constructor. The key has never been alive. */
+    BasicLifetime();
+
+    BasicLifetime(const BasicLifetime& other);
+
+    BasicLifetime(BasicLifetime&& other) noexcept;
+
+    ~BasicLifetime();
+
+    BasicLifetime& operator=(BasicLifetime other) noexcept;
+
+    /** Returns true if the key was alive at version. */
+    bool aliveAt(unsigned version) const;
+
+    /** Returns true if the key is alive after the last toggle. */
+    bool alive() const;
+
+    /**
+     * Records that the key is alive, or not, from version on. version must not be less
+     * than the last toggle; toggling twice within a version cancels out.
+     */
+    void record(unsigned version, bool alive);
+
+    /** Replaces the toggles in [from, to] by the single toggle at from, if any, that leaves the state at to unchanged. */
+    void squash(unsigned from, unsigned to);
+
+    /** Forgets toggles that no version from version onwards depends on. */
+    void releaseBefore(unsigned version);
+
+    /** Returns the number of toggles. */
+    size_t toggleCount() const;
+
+    /** Returns the ith toggle version. */
+    unsigned toggle(size_t i) const;
+
+    void swap(BasicLifetime& other) noexcept;
+
+private:
+    const unsigned* data() const;
+
+    unsigned* data();
+
+    uint32_t length;
+
+    uint32_t capacity;
+
+    union {
+        unsigned local[kInline];
+        unsigned* heap;
+    };
+};
+
+/** Lifetime of keys in stores with the default policy. */
+typedef BasicLifetime<2> Lifetime;
+
+
+/** Public Method implementations */
+template <uint32_t kInline>
+BasicLifetime<kInline>::BasicLifetime() : length(0), capacity(kInline), local() {}
+
+template <uint32_t kInline>
+BasicLifetime<kInline>::BasicLifetime(const BasicLifetime& other) : length(other.length), capacity(kInline), local() {
+    if (length > kInline) {
+        capacity = length;
+        heap = new unsigned[capacity];
+    }
+    std::memcpy(data(), other.data(), length * sizeof(unsigned));
+}
+
+template <uint32_t kInline>
+BasicLifetime<kInline>::BasicLifetime(BasicLifetime&& other) noexcept : length(0), capacity(kInline), local() {
+    swap(other);
+}
+
+template <uint32_t kInline>
+BasicLifetime<kInline>::~BasicLifetime() {
+    if (capacity > kInline) {
+        delete[] heap;
+    }
+}
+
+template <uint32_t kInline>
+BasicLifetime<kInline>& BasicLifetime<kInline>::operator=(BasicLifetime other) noexcept {
+    swap(other);
+    return *this;
+}
+
+template <uint32_t kInline>
+bool BasicLifetime<kInline>::aliveAt(unsigned version) const {
+    const unsigned* toggles = data();
+    return (std::upper_bound(toggles, toggles + length, version) - toggles) & 1;
+}
+
+template <uint32_t kInline>
+bool BasicLifetime<kInline>::alive() const {
+    return length & 1;
+}
+
+template <uint32_t kInline>
+void BasicLifetime<kInline>::record(unsigned version, bool alive) {
+    if (alive == this->alive()) {
+        return;
+    }
+    if (length > 0 && data()[length - 1] == version) {
+        --length;
+        return;
+    }
+    if (length == capacity) {
+        uint32_t grown = capacity * 2;
+        unsigned* toggles = new unsigned[grown];
+        std::memcpy(toggles, data(), length * sizeof(unsigned));
+        if (capacity > kInline) {
+            delete[] heap;
+        }
+        heap = toggles;
+        capacity = grown;
+    }
+    data()[length++] = version;
+}
+
+template <uint32_t kInline>
+void BasicLifetime<kInline>::squash(unsigned from, unsigned to) {
+    unsigned* toggles = data();
+    size_t first = std::lower_bound(toggles, toggles + length, from) - toggles;
+    size_t last = std::upper_bound(toggles, toggles + length, to) - toggles;
+    if ((last - first) & 1) {
+        toggles[first++] = from;
+    }
+    std::memmove(toggles + first, toggles + last, (length - last) * sizeof(unsigned));
+    length -= last - first;
+}
+
+template <uint32_t kInline>
+void BasicLifetime<kInline>::releaseBefore(unsigned version) {
+    unsigned* toggles = data();
+    size_t at_or_before = std::upper_bound(toggles, toggles + length, version) - toggles;
+    // keep the creation the key is alive from at version, if it is alive then
+    size_t first_kept = at_or_before & ~size_t(1);
+    if (first_kept == 0) {
+        return;
+    }
+    length -= first_kept;
+    std::memmove(toggles, toggles + first_kept, length * sizeof(unsigned));
+    if (capacity > kInline && length <= kInline) {
+        unsigned* heap_toggles = heap;
+        std::memcpy(local, heap_toggles, length * sizeof(unsigned));
+        delete[] heap_toggles;
+        capacity = kInline;
+    }
+}
+
+template <uint32_t kInline>
+size_t BasicLifetime<kInline>::toggleCount() const {
+    return length;
+}
+
+template <uint32_t kInline>
+unsigned BasicLifetime<kInline>::toggle(size_t i) const {
+    return data()[i];
+}
+
+template <uint32_t kInline>
+void BasicLifetime<kInline>::swap(BasicLifetime& other) noexcept {
+    // the union is swapped bytewise; it holds either the inline toggles or the pointer
+    char bytes[sizeof(local) > sizeof(heap) ? sizeof(local) : sizeof(heap)];
+    std::memcpy(bytes, local, sizeof(bytes));
+    std::memcpy(local, other.local, sizeof(bytes));
+    std::memcpy(other.local, bytes, sizeof(bytes));
+    std::swap(length, other.length);
+    std::swap(capacity, other.capacity);
+}
+
+
+/** Private Method Implementations */
+template <uint32_t kInline>
+const unsigned* BasicLifetime<kInline>::data() const {
+    return capacity > kInline ? heap : local;
+}
+
+template <uint32_t kInline>
+unsigned* BasicLifetime<kInline>::data() {
+    return capacity > kInline ? heap : local;
+}
+
+#endif // __LIFETIME__
@@ -0,0 +1,382 @@
+//
+// PerfectHashIndex.h
+//
+// Key index for stores whose keys are all known at compile time, such as
+// config fields. A schema lists the keys in a constexpr array, and a
+// perfect hash over them is searched for while compiling: keys are
+// grouped into buckets, and each bucket is given the first pilot value
+// that sends all of its keys to table positions no other key uses. A
+// lookup hashes the key once, reads its bucket's pilot and position from
+// constant tables and compares against the one key that can be there.
+//
+//
+
+#ifndef __PERFECT_HASH_INDEX__
+#define __PERFECT_HASH_INDEX__
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Key index implementing the interface of KeyIndex.h over the keys of Schema, which names
+ * them in a constexpr array of std::string_view or integers:
+ *
+ *     struct ConfigFields {
+ *         static constexpr std::string_view kKeys[] = {"timeout_ms", "retries", "endpoint"};
+ *     };
+ *
+ * K must convert to the array's element type and compare equal to it. Keys not in the
+ * schema are never found; inserting one throws std::out_of_range. Values are allocated
+ * together on the first insertion and never move.
+ */
+template <typename K, typename T, typename Schema>
+class PerfectHashIndex {
+public:
+    /** Number of keys in the schema. */
+    static constexpr size_t kKeyCount = std::size(Schema::kKeys);
+
+    PerfectHashIndex();
+
+    PerfectHashIndex(PerfectHashIndex&& other) noexcept;
+
+    PerfectHashIndex(const PerfectHashIndex& other) = delete;
+
+    PerfectHashIndex& operator=(PerfectHashIndex&& other) noexcept;
+
+    PerfectHashIndex& operator=(const PerfectHashIndex& other) = delete;
+
+    /** Returns the value mapped to key, or nullptr if there is none. */
+    T* find(const K& key);
+
+    /** Returns the value mapped to key, inserting a default constructed one if there is none. */
+    T& operator[](const K& key);
+
+    /** Removes key. Returns true if it was present. */
+    bool erase(const K& key);
+
+    /** 
+     * Calls fn(key, value) for every key in schema order, passing the schema's constant for 
+     * the key rather than constructing a K. fn must not insert or erase keys.
+     */
+    template <typename F>
+    void forEach(F fn);
+
+    /** Returns the number of keys. */
+    size_t size() const;
+
+    /** Removes every key. */
+    void clear() noexcept;
+
+    /** Exchanges the contents of this index with other in constant time. */
+    void swap(PerfectHashIndex& other) noexcept;
+
+private:
+    typedef typename std::remove_cv<typename std::remove_reference<decltype(Schema::kKeys[0])>::type>::type
+        KeyConstant;
+
+    static_assert(kKeyCount > 0, "the schema must list at least one key");
+    static_assert(std::is_integral<KeyConstant>::value || std::is_same<KeyConstant, std::string_view>::value,
+                  "schema keys must be integers or std::string_view");
+
+    /** Positions in the table, a power of two of at least twice the keys so pilots are found quickly. */
+    static constexpr size_t tableSize() {
+        size_t size = 1;
+        while (size < kKeyCount * 2) {
+            size *= 2;
+        }
+        return size;
+    }
+
+    static constexpr size_t kTableSize = tableSize();
+
+    /** Buckets of about two keys each, the keys of a bucket being placed together. */
+    static constexpr size_t kBuckets = kKeyCount / 2 + 1;
+
+    /** Pilots tried per bucket before the search gives up. */
+    static constexpr uint32_t kMaxPilot = 1u << 16;
+
+    /** Result of the compile time search. */
+    struct PerfectHash {
+        bool found;
+
+        uint32_t pilots[kBuckets];
+
+        /** One more than the schema index of the key at each position, or 0 if none is. */
+        uint32_t key_numbers[kTableSize];
+    };
+
+    /** Values and which of them are present, allocated once. */
+    struct Slots {
+        Slots() : present(), values() {}
+
+        bool present[kKeyCount];
+
+        T values[kKeyCount];
+    };
+
+    static constexpr uint64_t mix(uint64_t hash);
+
+    /** 
+     * Returns the little endian word of key's bytes from i. Gathered with shifts rather than 
+     * memcpy so it also runs at compile time; compilers turn the gathering into one load.
+     */
+    static constexpr uint64_t loadWord(std::string_view key, size_t i);
+
+    static constexpr uint64_t hashKey(std::string_view key);
+
+    template <typename I>
+    static constexpr uint64_t hashKey(I key);
+
+    static constexpr size_t bucketOf(uint64_t hash);
+
+    static constexpr size_t positionOf(uint64_t hash, uint32_t pilot);
+
+    /** Returns true if no two keys of the schema are equal. */
+    static constexpr bool keysDistinct();
+
+    static constexpr PerfectHash search();
+
+    /** Defined once search() is, below. */
+    static const PerfectHash kHash;
+
+    /** Returns the schema index of key, or kKeyCount if key is not in the schema. */
+    static size_t keyNumber(const K& key);
+
+    std::unique_ptr<Slots> slots;
+
+    size_t count;
+};
+
+
+/** Public Method implementations */
+template <typename K, typename T, typename Schema>
+PerfectHashIndex<K, T, Schema>::PerfectHashIndex() : count(0) {}
+
+template <typename K, typename T, typename Schema>
+PerfectHashIndex<K, T, Schema>::PerfectHashIndex(PerfectHashIndex&& other) noexcept
+    : slots(std::move(other.slots)), count(other.count) {
+    other.count = 0;
+}
+
+template <typename K, typename T, typename Schema>
+PerfectHashIndex<K, T, Schema>& PerfectHashIndex<K, T, Schema>::operator=(PerfectHashIndex&& other) noexcept {
+    PerfectHashIndex(std::move(other)).swap(*this);
+    return *this;
+}
+
+template <typename K, typename T, typename Schema>
+T* PerfectHashIndex<K, T, Schema>::find(const K& key) {
+    if (!slots) {
+        return nullptr;
+    }
+    size_t number = keyNumber(key);
+    return number < kKeyCount && slots->present[number] ? &slots->values[number] : nullptr;
+}
+
+template <typename K, typename T, typename Schema>
+T& PerfectHashIndex<K, T, Schema>::operator[](const K& key) {
+    size_t number = keyNumber(key);
+    if (number == kKeyCount) {
+        throw std::out_of_range("PerfectHashIndex: key is not in the schema");
+    }
+    if (!slots) {
+        slots.reset(new Slots());
+    }
+    if (!slots->present[number]) {
+        slots->present[number] = true;
+        ++count;
+    }
+    return slots->values[number];
+}
+
+template <typename K, typename T, typename Schema>
+bool PerfectHashIndex<K, T, Schema>::erase(const K& key) {
+    if (!slots) {
+        return false;
+    }
+    size_t number = keyNumber(key);
+    if (number == kKeyCount || !slots->present[number]) {
+        return false;
+    }
+    slots->present[number] = false;
+    slots->values[number] = T();
+    --count;
+    return true;
+}
+
+template <typename K, typename T, typename Schema>
+template <typename F>
+void PerfectHashIndex<K, T, Schema>::forEach(F fn) {
+    if (!slots) {
+        return;
+    }
+    for (size_t number = 0; number < kKeyCount; ++number) {
+        if (slots->present[number]) {
+            fn(Schema::kKeys[number], slots->values[number]);
+        }
+    }
+}
+
+template <typename K, typename T, typename Schema>
+size_t PerfectHashIndex<K, T, Schema>::size() const {
+    return count;
+}
+
+template <typename K, typename T, typename Schema>
+void PerfectHashIndex<K, T, Schema>::clear() noexcept {
+    slots.reset();
+    count = 0;
+}
+
+template <typename K, typename T, typename Schema>
+void PerfectHashIndex<K, T, Schema>::swap(PerfectHashIndex& other) noexcept {
+    slots.swap(other.slots);
+    std::swap(count, other.count);
+}
+
+
+/** Private Method Implementations */
+template <typename K, typename T, typename Schema>
+constexpr uint64_t PerfectHashIndex<K, T, Schema>::mix(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    return hash ^ (hash >> 33);
+}
+
+template <typename K, typename T, typename Schema>
+constexpr uint64_t PerfectHashIndex<K, T, Schema>::loadWord(std::string_view key, size_t i) {
+    // through a pointer, since indexing the view hides the pattern from the compiler
+    const char* bytes = key.data() + i;
+    return uint64_t(static_cast<unsigned char>(bytes[0])) |
+           uint64_t(static_cast<unsigned char>(bytes[1])) << 8 |
+           uint64_t(static_cast<unsigned char>(bytes[2])) << 16 |
+           uint64_t(static_cast<unsigned char>(bytes[3])) << 24 |
+           uint64_t(static_cast<unsigned char>(bytes[4])) << 32 |
+           uint64_t(static_cast<unsigned char>(bytes[5])) << 40 |
+           uint64_t(static_cast<unsigned char>(bytes[6])) << 48 |
+           uint64_t(static_cast<unsigned char>(bytes[7])) << 56;
+}
+
+template <typename K, typename T, typename Schema>
+constexpr uint64_t PerfectHashIndex<K, T, Schema>::hashKey(std::string_view key) {
+    uint64_t hash = key.size();
+    size_t i = 0;
+    for (; i + 8 <= key.size(); i += 8) {
+        hash = (hash ^ loadWord(key, i)) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 29;
+    }
+    uint64_t tail = 0;
+    for (size_t byte = 0; i + byte < key.size(); ++byte) {
+        tail |= uint64_t(static_cast<unsigned char>(key[i + byte])) << (8 * byte);
+    }
+    return mix(hash ^ tail);
+}
+
+template <typename K, typename T, typename Schema>
+template <typename I>
+constexpr uint64_t PerfectHashIndex<K, T, Schema>::hashKey(I key) {
+    return mix(static_cast<uint64_t>(key));
+}
+
+template <typename K, typename T, typename Schema>
+constexpr size_t PerfectHashIndex<K, T, Schema>::bucketOf(uint64_t hash) {
+    return static_cast<size_t>((hash >> 32) % kBuckets);
+}
+
+template <typename K, typename T, typename Schema>
+constexpr size_t PerfectHashIndex<K, T, Schema>::positionOf(uint64_t hash, uint32_t pilot) {
+    uint64_t position = (hash ^ (pilot * 0x9E3779B97F4A7C15ULL)) * 0xD6E8FEB86659FD93ULL;
+    return static_cast<size_t>(position >> 32) & (kTableSize - 1);
+}
+
+template <typename K, typename T, typename Schema>
+constexpr bool PerfectHashIndex<K, T, Schema>::keysDistinct() {
+    for (size_t number = 0; number < kKeyCount; ++number) {
+        for (size_t other = number + 1; other < kKeyCount; ++other) {
+            if (Schema::kKeys[number] == Schema::kKeys[other]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename K, typename T, typename Schema>
+constexpr typename PerfectHashIndex<K, T, Schema>::PerfectHash PerfectHashIndex<K, T, Schema>::search() {
+    PerfectHash result{};
+    uint64_t hashes[kKeyCount]{};
+    // members holds the keys of each bucket together, those of bucket b from starts[b]
+    size_t starts[kBuckets + 1]{};
+    for (size_t number = 0; number < kKeyCount; ++number) {
+        hashes[number] = hashKey(Schema::kKeys[number]);
+        ++starts[bucketOf(hashes[number]) + 1];
+    }
+    for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        starts[bucket + 1] += starts[bucket];
+    }
+    size_t members[kKeyCount]{};
+    size_t filled[kBuckets]{};
+    for (size_t number = 0; number < kKeyCount; ++number) {
+        size_t bucket = bucketOf(hashes[number]);
+        members[starts[bucket] + filled[bucket]++] = number;
+    }
+    // larger buckets are the hardest to place, so they go first while the table is empty
+    size_t order[kBuckets]{};
+    for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        size_t i = bucket;
+        while (i > 0 && filled[order[i - 1]] < filled[bucket]) {
+            order[i] = order[i - 1];
+            --i;
+        }
+        order[i] = bucket;
+    }
+    for (size_t bucket : order) {
+        const size_t* first = members + starts[bucket];
+        const size_t* last = members + starts[bucket + 1];
+        bool placed = first == last;
+        for (uint32_t pilot = 0; pilot < kMaxPilot && !placed; ++pilot) {
+            const size_t* member = first;
+            while (member != last && result.key_numbers[positionOf(hashes[*member], pilot)] == 0) {
+                result.key_numbers[positionOf(hashes[*member], pilot)] = static_cast<uint32_t>(*member + 1);
+                ++member;
+            }
+            placed = member == last;
+            if (placed) {
+                result.pilots[bucket] = pilot;
+            }
+            // otherwise undo the positions this pilot claimed for the bucket
+            while (!placed && member != first) {
+                --member;
+                result.key_numbers[positionOf(hashes[*member], pilot)] = 0;
+            }
+        }
+        if (!placed) {
+            // equal keys, or distinct keys hashing identically, which practically never happens
+            return result;
+        }
+    }
+    result.found = true;
+    return result;
+}
+
+template <typename K, typename T, typename Schema>
+constexpr typename PerfectHashIndex<K, T, Schema>::PerfectHash PerfectHashIndex<K, T, Schema>::kHash = search();
+
+template <typename K, typename T, typename Schema>
+size_t PerfectHashIndex<K, T, Schema>::keyNumber(const K& key) {
+    static_assert(keysDistinct(), "schema keys must be distinct");
+    static_assert(!keysDistinct() || kHash.found, "no perfect hash found for the schema keys, whose hashes collide");
+    uint64_t hash = hashKey(KeyConstant(key));
+    uint32_t number = kHash.key_numbers[positionOf(hash, kHash.pilots[bucketOf(hash)])];
+    return number != 0 && key == Schema::kKeys[number - 1] ? number - 1 : kKeyCount;
+}
+
+#endif // __PERFECT_HASH_INDEX__
@@ -0,0 +1,259 @@
+//
+// Policy.h
+//
+// Compile time configuration of VersionedKvStore. A policy is a struct
+// naming the value policy, key index, diff allocator, locking, when
+// histories are indexed and whether redundant diffs are merged. Custom
+// policies derive from a preset and override the members they change,
+// e.g.
+//
+//     struct DeltaPolicy : DefaultPolicy {
+//         template <typename V> using Values = DeltaStrings<>;
+//     };
+//
+//
+
+#ifndef __POLICY__
+#define __POLICY__
+
+#include "AdaptiveRadixTree.h"
+#include "Arena.h"
+#include "DenseIndex.h"
+#include "FastHash.h"
+#include "FixedIndex.h"
+#include "FixedPool.h"
+#include "KeyIndex.h"
+#include "PerfectHashIndex.h"
+#include "SmallIndex.h"
+#include "SwissTable.h"
+#include "ValuePolicy.h"
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+/** Locking policy for stores used from a single thread. Compiles away entirely. */
+struct NoLocking {
+    void lock() {}
+    void unlock() {}
+};
+
+/**
+ * Locking policy serializing every public store operation. Recursive, since
+ * operations such as Transaction::commit() call back into the store.
+ */
+class MutexLocking {
+public:
+    void lock() {
+        mutex.lock();
+    }
+
+    void unlock() {
+        mutex.unlock();
+    }
+
+private:
+    std::recursive_mutex mutex;
+};
+
+/**
+ * Diff allocator with the Arena interface that allocates every object on its own,
+ * returning the memory of dropped diffs to the system straight away.
+ */
+template <typename T>
+class HeapAllocator {
+public:
+    /** Objects still alive are not freed on destruction; the store destroys them. */
+    static const bool kReleasesOnDestruction = false;
+
+    HeapAllocator() {}
+
+    HeapAllocator(HeapAllocator&&) noexcept {}
+
+    HeapAllocator& operator=(HeapAllocator&&) noexcept {
+        return *this;
+    }
+
+    void swap(HeapAllocator&) noexcept {}
+
+    T* create() {
+        return new T();
+    }
+
+    void destroy(T* obj) {
+        delete obj;
+    }
+};
+
+/** The store as originally designed: full values, hashed keys, arena allocated diffs. */
+struct DefaultPolicy {
+    /** Value policy, see ValuePolicy.h. */
+    template <typename V>
+    using Values = FullValues<V>;
+
+    /** Key index, see KeyIndex.h. */
+    template <typename K, typename T>
+    using KeyIndex = HashIndex<K, T>;
+
+    /** Allocator for diffs. */
+    template <typename T>
+    using Allocator = Arena<T>;
+
+    /** If true, a write leaving a key as it was in the previous version drops its diff. */
+    static const bool kDedup = true;
+
+    /**
+     * Chains reaching this many diffs are also indexed by version, so historical reads
+     * binary search instead of walking prev_diff. Shorter chains stay plain lists.
+     */
+    static const unsigned kHistoryIndexThreshold = 32;
+
+    /** Locking around public operations. */
+    typedef NoLocking Locking;
+
+    /** Creations and erasures of a key recorded without allocating, see Lifetime.h. */
+    static const unsigned kInlineToggles = 2;
+
+    /** Saved versions whose sizes are held inside the store, as many as fit where a vector would be. */
+    static const uint32_t kInlineVersions = 2;
+
+    /**
+     * If true, entries leave out the state for spilling, KeyHandles and history indexes,
+     * halving them. enableSpill() and handle() then do not compile, and chains are walked.
+     */
+    static const bool kSlimEntries = false;
+
+    /** Most keys the key index may hold. trySet() refuses writes needing more. */
+    static const size_t kMaxKeys = SIZE_MAX;
+
+    /** Most diffs held at once. trySet() and tryErase() refuse writes needing more. */
+    static const size_t kMaxDiffs = SIZE_MAX;
+
+    /** Most creations and erasures recorded per key. trySet() and tryErase() refuse writes needing more. */
+    static const unsigned kMaxToggles = UINT_MAX;
+
+    /**
+     * Most versions whose bookkeeping is held at once, reserved when the store is
+     * constructed. save() reuses that of released versions, releasing the oldest if needed.
+     */
+    static const size_t kMaxVersions = SIZE_MAX;
+};
+
+/** 
+ * For read-heavy use: values kept in full so reads never decode, keys hashed by FastHash 
+ * and probed a group at a time in a Swiss table, early history indexing.
+ */
+struct ReadOptimized : DefaultPolicy {
+    template <typename K, typename T>
+    using KeyIndex = SwissTable<K, T, FastHash>;
+
+    static const unsigned kHistoryIndexThreshold = 8;
+};
+
+/** 
+ * For write-heavy use: writes skip comparing the new value against the previous version 
+ * and only very long chains pay for a history index.
+ */
+struct WriteOptimized : DefaultPolicy {
+    static const bool kDedup = false;
+
+    static const unsigned kHistoryIndexThreshold = 256;
+};
+
+/**
+ * For large histories: std::string values are delta encoded, keys share prefixes in an
+ * adaptive radix tree and dropped diffs are returned to the system.
+ */
+struct LowMemory : DefaultPolicy {
+    template <typename V>
+    using Values = typename std::conditional<std::is_same<V, std::string>::value,
+                                             DeltaStrings<>, FullValues<V>>::type;
+
+    template <typename K, typename T>
+    using KeyIndex = AdaptiveRadixTree<K, T>;
+
+    template <typename T>
+    using Allocator = HeapAllocator<T>;
+
+    static const unsigned kHistoryIndexThreshold = 1024;
+};
+
+/** For integer keys drawn densely from 0, such as entity ids: keys index an array directly. */
+struct DenseKeys : DefaultPolicy {
+    template <typename K, typename T>
+    using KeyIndex = DenseIndex<K, T>;
+};
+
+/** 
+ * For many stores of a few keys each: up to 8 keys are held in an array sized to them and 
+ * searched without a hash table, entries are slim, the sizes of a few saved versions are 
+ * held inside the store, and diffs are allocated one by one instead of in blocks sized for 
+ * large stores. The store can neither spill nor hand out KeyHandles.
+ */
+struct SmallStore : DefaultPolicy {
+    template <typename K, typename T>
+    using KeyIndex = SmallIndex<K, T>;
+
+    template <typename T>
+    using Allocator = HeapAllocator<T>;
+
+    static const bool kSlimEntries = true;
+};
+
+/**
+ * For latency critical paths that must not allocate: up to kKeys keys and kDiffs diffs are
+ * held inside the store object, and bookkeeping for kVersions versions is reserved on
+ * construction. trySet(), tryErase(), compareAndSet() and update() return false instead of
+ * exceeding the capacity; writes that cannot report a full store, such as set(), erase(),
+ * upsert(), handle() and transactions, do not compile, nor does spilling. Versions are
+ * released, and their diffs, keys and bookkeeping freed for reuse, with
+ * releaseVersionsBefore(); once kVersions versions are held, save() releases the oldest.
+ * V should not allocate either. The store can be neither moved nor swapped.
+ */
+template <size_t kKeys, size_t kDiffs, size_t kVersions = 1024>
+struct FixedCapacity : DefaultPolicy {
+    static_assert(kVersions >= 2, "the saved version and the one being written each need bookkeeping");
+
+    template <typename K, typename T>
+    using KeyIndex = FixedIndex<K, T, kKeys>;
+
+    template <typename T>
+    using Allocator = FixedPool<T, kDiffs>;
+
+    static const unsigned kHistoryIndexThreshold = UINT_MAX;
+
+    static const unsigned kInlineToggles = 4;
+
+    static const size_t kMaxKeys = kKeys;
+
+    static const size_t kMaxDiffs = kDiffs;
+
+    static const unsigned kMaxToggles = kInlineToggles;
+
+    static const size_t kMaxVersions = kVersions;
+};
+
+/**
+ * For stores whose keys are all known at compile time, such as config fields: Schema lists
+ * them in a constexpr array, see PerfectHashIndex.h, and a perfect hash built while
+ * compiling finds each key with one hash and one comparison. Writing a key outside the
+ * schema throws std::out_of_range.
+ */
+template <typename Schema>
+struct KnownKeys : DefaultPolicy {
+    template <typename K, typename T>
+    using KeyIndex = PerfectHashIndex<K, T, Schema>;
+};
+
+/**
+ * The default store, safe to share between threads. swap() and moves lock both
+ * stores, in address order, so they may run alongside operations on either.
+ */
+struct ThreadSafe : DefaultPolicy {
+    typedef MutexLocking Locking;
+};
+
+#endif // __POLICY__
@@ -0,0 +1,310 @@
+//
+// RadixTree.h
+//
+// Key index over std::string keys that stores each shared prefix once.
+// Nodes are labelled with the bytes of the edge leading to them, so a
+// chain of nodes with a single child collapses into one node. Keys are
+// visited in byte-wise lexicographic order.
+//
+//
+
+#ifndef __RADIX_TREE__
+#define __RADIX_TREE__
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+using std::vector;
+
+/** Path compressed trie implementing the key index interface of KeyIndex.h. */
+template <typename K, typename T>
+class RadixTree {
+    static_assert(std::is_same<K, std::string>::value, "RadixTree keys must be std::string");
+
+public:
+    /** Constructor. No memory is allocated until the first key is inserted. */
+    RadixTree();
+
+    RadixTree(RadixTree&& other) noexcept;
+
+    RadixTree(const RadixTree& other) = delete;
+
+    ~RadixTree();
+
+    RadixTree& operator=(RadixTree&& other) noexcept;
+
+    RadixTree& operator=(const RadixTree& other) = delete;
+
+    /** Returns the value mapped to key, or nullptr if there is none. */
+    T* find(const K& key);
+
+    /** Returns the value mapped to key, inserting a default constructed one if there is none. */
+    T& operator[](const K& key);
+
+    /** Removes key. Returns true if it was present. */
+    bool erase(const K& key);
+
+    /** Calls fn(key, value) for every key in lexicographic order. fn must not insert or erase keys. */
+    template <typename F>
+    void forEach(F fn);
+
+    /** Returns the number of keys. */
+    size_t size() const;
+
+    /** Removes every key. */
+    void clear() noexcept;
+
+    /** Exchanges the contents of this tree with other in constant time. */
+    void swap(RadixTree& other) noexcept;
+
+private:
+    struct Node {
+        Node() : has_value(false), value() {}
+
+        /** Bytes of the edge from the parent. Empty only for the root. */
+        std::string label;
+
+        /** Children ordered by the first byte of their label. */
+        vector<Node*> children;
+
+        bool has_value;
+
+        T value;
+    };
+
+    /** Returns the position in node->children of the child whose label starts with byte. */
+    static size_t childPosition(Node* node, unsigned char byte);
+
+    /** Returns true if position is a child of node whose label starts with byte. */
+    static bool isChild(Node* node, size_t position, unsigned char byte);
+
+    /** Calls fn for the keys of node and its descendants. path holds the key of node. */
+    template <typename F>
+    static void visit(Node* node, std::string& path, F& fn);
+
+    /** Frees node and its descendants. */
+    static void destroy(Node* node);
+
+    /** Replaces node, which has no value and a single child, by that child. parent_slot points at node. */
+    static void mergeWithChild(Node*& parent_slot);
+
+    Node* root;
+
+    size_t count;
+};
+
+
+/** Public Method implementations */
+template <typename K, typename T>
+RadixTree<K, T>::RadixTree() : root(nullptr), count(0) {}
+
+template <typename K, typename T>
+RadixTree<K, T>::RadixTree(RadixTree&& other) noexcept : root(other.root), count(other.count) {
+    other.root = nullptr;
+    other.count = 0;
+}
+
+template <typename K, typename T>
+RadixTree<K, T>::~RadixTree() {
+    clear();
+}
+
+template <typename K, typename T>
+RadixTree<K, T>& RadixTree<K, T>::operator=(RadixTree&& other) noexcept {
+    RadixTree(std::move(other)).swap(*this);
+    return *this;
+}
+
+template <typename K, typename T>
+T* RadixTree<K, T>::find(const K& key) {
+    Node* node = root;
+    size_t position = 0;
+    while (node) {
+        if (position == key.size()) {
+            return node->has_value ? &node->value : nullptr;
+        }
+        unsigned char byte = key[position];
+        size_t child = childPosition(node, byte);
+        if (!isChild(node, child, byte)) {
+            return nullptr;
+        }
+        node = node->children[child];
+        if (key.compare(position, node->label.size(), node->label) != 0) {
+            return nullptr;
+        }
+        position += node->label.size();
+    }
+    return nullptr;
+}
+
+template <typename K, typename T>
+T& RadixTree<K, T>::operator[](const K& key) {
+    if (!root) {
+        root = new Node();
+    }
+    Node* node = root;
+    size_t position = 0;
+    while (position < key.size()) {
+        unsigned char byte = key[position];
+        size_t child = childPosition(node, byte);
+        if (!isChild(node, child, byte)) {
+            Node* leaf = new Node();
+            leaf->label = key.substr(position);
+            node->children.insert(node->children.begin() + child, leaf);
+            node = leaf;
+            break;
+        }
+        Node* next = node->children[child];
+        size_t common = 0;
+        while (common < next->label.size() && position + common < key.size()
+                && next->label[common] == key[position + common]) {
+            ++common;
+        }
+        if (common < next->label.size()) {
+            // split the edge; next keeps its value and only loses the shared bytes
+            Node* middle = new Node();
+            middle->label = next->label.substr(0, common);
+            next->label.erase(0, common);
+            middle->children.push_back(next);
+            node->children[child] = middle;
+            next = middle;
+        }
+        node = next;
+        position += common;
+    }
+    if (!node->has_value) {
+        node->has_value = true;
+        ++count;
+    }
+    return node->value;
+}
+
+template <typename K, typename T>
+bool RadixTree<K, T>::erase(const K& key) {
+    // slots[i] points at the pointer to the ith node on the path
+    vector<Node**> slots;
+    Node** slot = &root;
+    size_t position = 0;
+    while (*slot) {
+        slots.push_back(slot);
+        Node* node = *slot;
+        if (position == key.size()) {
+            break;
+        }
+        unsigned char byte = key[position];
+        size_t child = childPosition(node, byte);
+        if (!isChild(node, child, byte)) {
+            return false;
+        }
+        Node* next = node->children[child];
+        if (key.compare(position, next->label.size(), next->label) != 0) {
+            return false;
+        }
+        position += next->label.size();
+        slot = &node->children[child];
+    }
+    if (!*slot || !(*slot)->has_value) {
+        return false;
+    }
+
+    Node* node = *slot;
+    node->has_value = false;
+    node->value = T();
+    --count;
+    if (node == root) {
+        return true;
+    }
+    if (node->children.empty()) {
+        Node** parent_slot = slots[slots.size() - 2];
+        Node* parent = *parent_slot;
+        parent->children.erase(std::find(parent->children.begin(), parent->children.end(), node));
+        delete node;
+        if (parent != root && !parent->has_value && parent->children.size() == 1) {
+            mergeWithChild(*parent_slot);
+        }
+    } else if (node->children.size() == 1) {
+        mergeWithChild(*slot);
+    }
+    return true;
+}
+
+template <typename K, typename T>
+template <typename F>
+void RadixTree<K, T>::forEach(F fn) {
+    if (root) {
+        std::string path;
+        visit(root, path, fn);
+    }
+}
+
+template <typename K, typename T>
+size_t RadixTree<K, T>::size() const {
+    return count;
+}
+
+template <typename K, typename T>
+void RadixTree<K, T>::clear() noexcept {
+    if (root) {
+        destroy(root);
+    }
+    root = nullptr;
+    count = 0;
+}
+
+template <typename K, typename T>
+void RadixTree<K, T>::swap(RadixTree& other) noexcept {
+    std::swap(root, other.root);
+    std::swap(count, other.count);
+}
+
+
+/** Private Method Implementations */
+template <typename K, typename T>
+size_t RadixTree<K, T>::childPosition(Node* node, unsigned char byte) {
+    auto it = std::lower_bound(node->children.begin(), node->children.end(), byte,
+        [](Node* child, unsigned char first) {
+            return static_cast<unsigned char>(child->label[0]) < first;
+        });
+    return it - node->children.begin();
+}
+
+template <typename K, typename T>
+bool RadixTree<K, T>::isChild(Node* node, size_t position, unsigned char byte) {
+    return position < node->children.size()
+        && static_cast<unsigned char>(node->children[position]->label[0]) == byte;
+}
+
+template <typename K, typename T>
+template <typename F>
+void RadixTree<K, T>::visit(Node* node, std::string& path, F& fn) {
+    if (node->has_value) {
+        fn(static_cast<const K&>(path), node->value);
+    }
+    for (Node* child : node->children) {
+        path.append(child->label);
+        visit(child, path, fn);
+        path.resize(path.size() - child->label.size());
+    }
+}
+
+template <typename K, typename T>
+void RadixTree<K, T>::destroy(Node* node) {
+    for (Node* child : node->children) {
+        destroy(child);
+    }
+    delete node;
+}
+
+template <typename K, typename T>
+void RadixTree<K, T>::mergeWithChild(Node*& parent_slot) {
+    Node* node = parent_slot;
+    Node* child = node->children[0];
+    child->label.insert(0, node->label);
+    parent_slot = child;
+    delete node;
+}
+
+#endif // __RADIX_TREE__
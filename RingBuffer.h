@@ -0,0 +1,99 @@
+//
+// RingBuffer.h
+//
+// A bounded lock-free queue for handing items from exactly one
+// producer thread to exactly one consumer thread.
+//
+//
+
+#ifndef __RING_BUFFER__
+#define __RING_BUFFER__
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+using std::vector;
+
+/** Single producer, single consumer ring buffer of items of type T. */
+template <typename T>
+class SpscRingBuffer {
+public:
+    /** Constructor. Capacity is rounded up to the next power of two. */
+    explicit SpscRingBuffer(size_t capacity);
+
+    SpscRingBuffer(const SpscRingBuffer& other) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer& other) = delete;
+
+    /**
+     * Appends item. Returns false, leaving item untouched, if the buffer is full.
+     * Must only be called from the producer thread.
+     */
+    bool tryPush(T&& item);
+
+    /**
+     * Moves the oldest item into item. Returns false if the buffer is empty.
+     * Must only be called from the consumer thread.
+     */
+    bool tryPop(T& item);
+
+    /** Returns the maximum number of items the buffer can hold. */
+    size_t capacity() const;
+
+private:
+    /** Assumed cache line size, used to keep the two indices from false sharing. */
+    static const size_t kCacheLine = 64;
+
+    /** Item storage, indexed by position masked to its size. */
+    vector<T> slots;
+
+    /** slots.size() - 1. */
+    size_t mask;
+
+    /** Position of the next item to pop. Written only by the consumer. */
+    alignas(kCacheLine) std::atomic<size_t> head;
+
+    /** Position of the next item to push. Written only by the producer. */
+    alignas(kCacheLine) std::atomic<size_t> tail;
+};
+
+
+/** Public Method implementations */
+template <typename T>
+SpscRingBuffer<T>::SpscRingBuffer(size_t capacity) : head(0), tail(0) {
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    slots.resize(rounded);
+    mask = rounded - 1;
+}
+
+template <typename T>
+bool SpscRingBuffer<T>::tryPush(T&& item) {
+    size_t position = tail.load(std::memory_order_relaxed);
+    if (position - head.load(std::memory_order_acquire) == slots.size()) {
+        return false;
+    }
+    slots[position & mask] = std::move(item);
+    tail.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool SpscRingBuffer<T>::tryPop(T& item) {
+    size_t position = head.load(std::memory_order_relaxed);
+    if (position == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    item = std::move(slots[position & mask]);
+    head.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+size_t SpscRingBuffer<T>::capacity() const {
+    return slots.size();
+}
+
+#endif // __RING_BUFFER__
@@ -0,0 +1,54 @@
+//
+// Serializer.h
+//
+// Conversion of values to and from bytes, used when parts of a store
+// are written out to disk. Specialize Serializer for types that are
+// neither trivially copyable nor std::string.
+//
+//
+
+#ifndef __SERIALIZER__
+#define __SERIALIZER__
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+/** Serializer for trivially copyable types, which are written as their raw bytes. */
+template <typename T>
+struct Serializer {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Serializer must be specialized for types that are not trivially copyable");
+
+    /** Appends the bytes of value to out. */
+    static void write(std::string& out, const T& value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    /** Reads a value written by write() starting at in, and advances in past it. */
+    static T read(const char*& in) {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+    }
+};
+
+/** Serializer for strings, which are written as their length followed by their characters. */
+template <>
+struct Serializer<std::string> {
+    static void write(std::string& out, const std::string& value) {
+        Serializer<uint64_t>::write(out, value.size());
+        out.append(value);
+    }
+
+    static std::string read(const char*& in) {
+        uint64_t length = Serializer<uint64_t>::read(in);
+        std::string value(in, length);
+        in += length;
+        return value;
+    }
+};
+
+#endif // __SERIALIZER__
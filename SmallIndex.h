@@ -0,0 +1,241 @@
+//
+// SmallIndex.h
+//
+// Key index for stores that usually hold a handful of keys. Up to
+// kInline keys and their values live in one heap array that grows with
+// them, sized to the keys actually held, and are found by a linear
+// search with no table and no hashing. An empty index allocates nothing.
+// Once more keys are inserted, every key moves to a SwissTable.
+//
+//
+
+#ifndef __SMALL_INDEX__
+#define __SMALL_INDEX__
+
+#include "SwissTable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+
+/**
+ * Array backed key index implementing the interface of KeyIndex.h, moving its keys into
+ * a SwissTable past kInline. Values move when keys are inserted or erased.
+ */
+template <typename K, typename T, typename Hash = std::hash<K>, unsigned kInline = 8>
+class SmallIndex {
+public:
+    static_assert(kInline > 0, "the array holds at least one key");
+
+    /** Values move as the array grows and shrinks, see MovesValues in KeyIndex.h. */
+    static const bool kMovesValues = true;
+
+    SmallIndex();
+
+    SmallIndex(SmallIndex&& other) noexcept;
+
+    SmallIndex(const SmallIndex& other) = delete;
+
+    ~SmallIndex();
+
+    SmallIndex& operator=(SmallIndex&& other) noexcept;
+
+    SmallIndex& operator=(const SmallIndex& other) = delete;
+
+    /** Returns the value mapped to key, or nullptr if there is none. */
+    T* find(const K& key);
+
+    /** Returns the value mapped to key, inserting a default constructed one if there is none. */
+    T& operator[](const K& key);
+
+    /** Removes key. Returns true if it was present. */
+    bool erase(const K& key);
+
+    /** Calls fn(key, value) for every key. fn must not insert or erase keys. */
+    template <typename F>
+    void forEach(F fn);
+
+    /** Returns the number of keys. */
+    size_t size() const;
+
+    /** Removes every key, freeing the array or table. */
+    void clear() noexcept;
+
+    /** Exchanges the contents of this index with other in constant time. */
+    void swap(SmallIndex& other) noexcept;
+
+private:
+    typedef SwissTable<K, T, Hash> Table;
+
+    struct Slot {
+        explicit Slot(const K& key) : key(key), value() {}
+
+        K key;
+
+        T value;
+    };
+
+    /** Moves the slots to an array of capacity slots. */
+    void reallocate(uint32_t capacity);
+
+    /** Moves every key to table, freeing the array. */
+    void moveToTable();
+
+    /** Array of capacity slots, the first count constructed, or nullptr while capacity is 0. */
+    Slot* slots;
+
+    uint32_t count;
+
+    uint32_t capacity;
+
+    /** Every key once more than kInline were held, or nullptr while they fit in slots. */
+    std::unique_ptr<Table> table;
+};
+
+
+/** Public Method implementations */
+template <typename K, typename T, typename Hash, unsigned kInline>
+SmallIndex<K, T, Hash, kInline>::SmallIndex() : slots(nullptr), count(0), capacity(0) {}
+
+template <typename K, typename T, typename Hash, unsigned kInline>
+SmallIndex<K, T, Hash, kInline>::SmallIndex(SmallIndex&& other) noexcept : SmallIndex() {
+    swap(other);
+}
+
+template <typename K, typename T, typename Hash, unsigned kInline>
+SmallIndex<K, T, Hash, kInline>::~SmallIndex() {
+    clear();
+}
+
+template <typename K, typename T, typename Hash, unsigned kInline>
+SmallIndex<K, T, Hash, kInline>& SmallIndex<K, T, Hash, kInline>::operator=(SmallIndex&& other) noexcept {
+    SmallIndex(std::move(other)).swap(*this);
+    return *this;
+}
+
+template <typename K, typename T, typename Hash, unsigned kInline>
+T* SmallIndex<K, T, Hash, kInline>::find(const K& key) {
+    if (table) {
+        return table->find(key);
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        if (slots[i].key == key) {
+            return &slots[i].value;
+        }
+    }
+    return nullptr;
+}
+
+template <typename K, typename T, typename Hash, unsigned kInline>
+T& SmallIndex<K, T, Hash, kInline>::operator[](const K& key) {
+    T* value = find(key);
+    if (value) {
+        return *value;
+    }
+    if (!table && count == kInline) {
+        moveToTable();
+    }
+    if (table) {
+        return (*table)[key];
+    }
+    if (count == capacity) {
+        // doubling from one, so a store of a few keys holds little more than it needs
+        reallocate(capacity == 0 ? 1 : capacity * 2 < kInline ? capacity * 2 : kInline);
+    }
+    Slot* inserted = new (slots + count) Slot(key);
+    ++count;
+    return inserted->value;
+}
+
+template <typename K, typename T, typename Hash, unsigned kInline>
+bool SmallIndex<K, T, Hash, kInline>::erase(const K& key) {
+    if (table) {
+        if (!table->erase(key)) {
+            return false;
+        }
+        if (table->size() == 0) {
+            table.reset();
+        }
+        return true;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        if (slots[i].key == key) {
+            // the last slot fills the gap
+            if (i + 1 < count) {
+                slots[i] = std::move(slots[count - 1]);
+            }
+            slots[--count].~Slot();
+            if (count == 0) {
+                reallocate(0);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename K, typename T, typename Hash, unsigned kInline>
+template <typename F>
+void SmallIndex<K, T, Hash, kInline>::forEach(F fn) {
+    if (table) {
+        table->forEach(fn);
+        return;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        fn(static_cast<const K&>(slots[i].key), slots[i].value);
+    }
+}
+
+template <typename K, typename T, typename Hash, unsigned kInline>
+size_t SmallIndex<K, T, Hash, kInline>::size() const {
+    return table ? table->size() : count;
+}
+
+template <typename K, typename T, typename Hash, unsigned kInline>
+void SmallIndex<K, T, Hash, kInline>::clear() noexcept {
+    while (count > 0) {
+        slots[--count].~Slot();
+    }
+    reallocate(0);
+    table.reset();
+}
+
+template <typename K, typename T, typename Hash, unsigned kInline>
+void SmallIndex<K, T, Hash, kInline>::swap(SmallIndex& other) noexcept {
+    std::swap(slots, other.slots);
+    std::swap(count, other.count);
+    std::swap(capacity, other.capacity);
+    table.swap(other.table);
+}
+
+
+/** Private Method Implementations */
+template <typename K, typename T, typename Hash, unsigned kInline>
+void SmallIndex<K, T, Hash, kInline>::reallocate(uint32_t capacity) {
+    std::allocator<Slot> allocator;
+    Slot* moved = capacity > 0 ? allocator.allocate(capacity) : nullptr;
+    for (uint32_t i = 0; i < count; ++i) {
+        new (moved + i) Slot(std::move(slots[i]));
+        slots[i].~Slot();
+    }
+    if (slots) {
+        allocator.deallocate(slots, this->capacity);
+    }
+    slots = moved;
+    this->capacity = capacity;
+}
+
+template <typename K, typename T, typename Hash, unsigned kInline>
+void SmallIndex<K, T, Hash, kInline>::moveToTable() {
+    std::unique_ptr<Table> moved(new Table());
+    for (uint32_t i = 0; i < count; ++i) {
+        (*moved)[slots[i].key] = std::move(slots[i].value);
+    }
+    clear();
+    table = std::move(moved);
+}
+
+#endif // __SMALL_INDEX__
@@ -0,0 +1,196 @@
+//
+// SmallVector.h
+//
+// Vector of trivially copyable elements holding the first kInline of
+// them inside the object, for bookkeeping that usually stays short.
+// It moves to the heap once it grows past kInline and keeps that memory,
+// so space reserved up front is never given back.
+//
+//
+
+#ifndef __SMALL_VECTOR__
+#define __SMALL_VECTOR__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+/** Vector of T holding up to kInline elements without allocating. */
+template <typename T, uint32_t kInline>
+class SmallVector {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "elements are moved with memcpy");
+    static_assert(kInline > 0, "at least one element is held inline");
+
+    /** Constructor. The vector is empty. */
+    SmallVector();
+
+    SmallVector(SmallVector&& other) noexcept;
+
+    SmallVector(const SmallVector& other) = delete;
+
+    ~SmallVector();
+
+    SmallVector& operator=(SmallVector&& other) noexcept;
+
+    SmallVector& operator=(const SmallVector& other) = delete;
+
+    size_t size() const;
+
+    bool empty() const;
+
+    T& operator[](size_t i);
+
+    const T& operator[](size_t i) const;
+
+    T* begin();
+
+    T* end();
+
+    /** Makes room for capacity elements, so pushing that many does not allocate. */
+    void reserve(size_t capacity);
+
+    void push_back(const T& element);
+
+    /** Removes the elements in [first, last). */
+    void erase(T* first, T* last);
+
+    /** Removes every element, keeping the memory already allocated. */
+    void clear() noexcept;
+
+    void swap(SmallVector& other) noexcept;
+
+private:
+    /** Moves the elements to a heap array of capacity elements, which must exceed kInline. */
+    void reallocate(uint32_t capacity);
+
+    const T* data() const;
+
+    T* data();
+
+    uint32_t length;
+
+    uint32_t capacity;
+
+    union {
+        T local[kInline];
+        T* heap;
+    };
+};
+
+
+/** Public Method implementations */
+template <typename T, uint32_t kInline>
+SmallVector<T, kInline>::SmallVector() : length(0), capacity(kInline), local() {}
+
+template <typename T, uint32_t kInline>
+SmallVector<T, kInline>::SmallVector(SmallVector&& other) noexcept : length(0), capacity(kInline), local() {
+    swap(other);
+}
+
+template <typename T, uint32_t kInline>
+SmallVector<T, kInline>::~SmallVector() {
+    if (capacity > kInline) {
+        delete[] heap;
+    }
+}
+
+template <typename T, uint32_t kInline>
+SmallVector<T, kInline>& SmallVector<T, kInline>::operator=(SmallVector&& other) noexcept {
+    SmallVector(std::move(other)).swap(*this);
+    return *this;
+}
+
+template <typename T, uint32_t kInline>
+size_t SmallVector<T, kInline>::size() const {
+    return length;
+}
+
+template <typename T, uint32_t kInline>
+bool SmallVector<T, kInline>::empty() const {
+    return length == 0;
+}
+
+template <typename T, uint32_t kInline>
+T& SmallVector<T, kInline>::operator[](size_t i) {
+    return data()[i];
+}
+
+template <typename T, uint32_t kInline>
+const T& SmallVector<T, kInline>::operator[](size_t i) const {
+    return data()[i];
+}
+
+template <typename T, uint32_t kInline>
+T* SmallVector<T, kInline>::begin() {
+    return data();
+}
+
+template <typename T, uint32_t kInline>
+T* SmallVector<T, kInline>::end() {
+    return data() + length;
+}
+
+template <typename T, uint32_t kInline>
+void SmallVector<T, kInline>::reserve(size_t capacity) {
+    if (capacity > this->capacity) {
+        reallocate(static_cast<uint32_t>(capacity));
+    }
+}
+
+template <typename T, uint32_t kInline>
+void SmallVector<T, kInline>::push_back(const T& element) {
+    if (length == capacity) {
+        reallocate(capacity * 2);
+    }
+    data()[length++] = element;
+}
+
+template <typename T, uint32_t kInline>
+void SmallVector<T, kInline>::erase(T* first, T* last) {
+    std::memmove(first, last, (end() - last) * sizeof(T));
+    length -= static_cast<uint32_t>(last - first);
+}
+
+template <typename T, uint32_t kInline>
+void SmallVector<T, kInline>::clear() noexcept {
+    length = 0;
+}
+
+template <typename T, uint32_t kInline>
+void SmallVector<T, kInline>::swap(SmallVector& other) noexcept {
+    // the union is swapped bytewise; it holds either the inline elements or the pointer
+    char bytes[sizeof(local) > sizeof(heap) ? sizeof(local) : sizeof(heap)];
+    std::memcpy(bytes, local, sizeof(bytes));
+    std::memcpy(local, other.local, sizeof(bytes));
+    std::memcpy(other.local, bytes, sizeof(bytes));
+    std::swap(length, other.length);
+    std::swap(capacity, other.capacity);
+}
+
+
+/** Private Method Implementations */
+template <typename T, uint32_t kInline>
+void SmallVector<T, kInline>::reallocate(uint32_t capacity) {
+    T* elements = new T[capacity];
+    std::memcpy(elements, data(), length * sizeof(T));
+    if (this->capacity > kInline) {
+        delete[] heap;
+    }
+    heap = elements;
+    this->capacity = capacity;
+}
+
+template <typename T, uint32_t kInline>
+const T* SmallVector<T, kInline>::data() const {
+    return capacity > kInline ? heap : local;
+}
+
+template <typename T, uint32_t kInline>
+T* SmallVector<T, kInline>::data() {
+    return capacity > kInline ? heap : local;
+}
+
+#endif // __SMALL_VECTOR__
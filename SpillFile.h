@@ -0,0 +1,186 @@
+//
+// SpillFile.h
+//
+// Scratch file holding variable length records that were moved out of
+// memory. Records are written and read back by offset, and the space of
+// released records is reused; the file is removed when the SpillFile is
+// destroyed.
+//
+//
+
+#ifndef __SPILL_FILE__
+#define __SPILL_FILE__
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+/** 
+ * File of records addressed by offset. Released records leave free extents, merged 
+ * with free neighbours, that later records are written into best fit first.
+ */
+class SpillFile {
+public:
+    /** Constructor. Creates or truncates the file at path. Throws std::runtime_error on failure. */
+    explicit SpillFile(const std::string& path);
+
+    /** Destructor. Closes and removes the file. */
+    ~SpillFile();
+
+    SpillFile(const SpillFile& other) = delete;
+    SpillFile& operator=(const SpillFile& other) = delete;
+
+    /** Writes record and returns the offset to read it back from. */
+    uint64_t append(const std::string& record);
+
+    /** Returns the record written at offset. */
+    std::string read(uint64_t offset);
+
+    /** Frees the space of the record written at offset, which is no longer read. */
+    void release(uint64_t offset);
+
+    /** Discards every record, truncating the file. */
+    void clear();
+
+    /** Returns the number of bytes in use, including free extents between records. */
+    uint64_t fileSize() const;
+
+private:
+    /** Marks the extent of length bytes at offset free. It must not border another free extent. */
+    void addFree(uint64_t offset, uint64_t length);
+
+    /** Unmarks the free extent of length bytes at offset. */
+    void removeFree(uint64_t offset, uint64_t length);
+
+    /** Throws std::runtime_error describing a failed operation. */
+    void fail(const char* operation);
+
+    std::string path;
+
+    std::FILE* file;
+
+    /** Offset past the last record. */
+    uint64_t end;
+
+    /** Free extents before end, keyed by offset, so neighbours can be merged. */
+    std::map<uint64_t, uint64_t> free_by_offset;
+
+    /** The same extents keyed by length, for best fit. */
+    std::multimap<uint64_t, uint64_t> free_by_length;
+};
+
+
+/** Public Method implementations */
+inline SpillFile::SpillFile(const std::string& path) : path(path), end(0) {
+    file = std::fopen(path.c_str(), "w+b");
+    if (!file) {
+        fail("open");
+    }
+}
+
+inline SpillFile::~SpillFile() {
+    std::fclose(file);
+    std::remove(path.c_str());
+}
+
+inline uint64_t SpillFile::append(const std::string& record) {
+    uint64_t length = record.size();
+    uint64_t extent = sizeof(length) + length;
+    uint64_t offset = end;
+    std::multimap<uint64_t, uint64_t>::iterator fit = free_by_length.lower_bound(extent);
+    if (fit != free_by_length.end()) {
+        offset = fit->second;
+        uint64_t free_length = fit->first;
+        removeFree(offset, free_length);
+        if (free_length > extent) {
+            addFree(offset + extent, free_length - extent);
+        }
+    } else {
+        end += extent;
+    }
+    if (fseeko(file, offset, SEEK_SET) != 0
+            || std::fwrite(&length, sizeof(length), 1, file) != 1
+            || std::fwrite(record.data(), 1, record.size(), file) != record.size()) {
+        fail("write");
+    }
+    return offset;
+}
+
+inline std::string SpillFile::read(uint64_t offset) {
+    uint64_t length;
+    if (fseeko(file, offset, SEEK_SET) != 0 || std::fread(&length, sizeof(length), 1, file) != 1) {
+        fail("read");
+    }
+    std::string record(length, '\0');
+    if (std::fread(&record[0], 1, length, file) != length) {
+        fail("read");
+    }
+    return record;
+}
+
+inline void SpillFile::release(uint64_t offset) {
+    uint64_t length;
+    if (fseeko(file, offset, SEEK_SET) != 0 || std::fread(&length, sizeof(length), 1, file) != 1) {
+        fail("read");
+    }
+    length += sizeof(length);
+
+    std::map<uint64_t, uint64_t>::iterator next = free_by_offset.find(offset + length);
+    if (next != free_by_offset.end()) {
+        uint64_t next_length = next->second;
+        removeFree(offset + length, next_length);
+        length += next_length;
+    }
+    std::map<uint64_t, uint64_t>::iterator prev = free_by_offset.lower_bound(offset);
+    if (prev != free_by_offset.begin() && (--prev)->first + prev->second == offset) {
+        uint64_t prev_offset = prev->first;
+        uint64_t prev_length = prev->second;
+        removeFree(prev_offset, prev_length);
+        offset = prev_offset;
+        length += prev_length;
+    }
+    if (offset + length == end) {
+        // trailing free space is simply written over by later appends
+        end = offset;
+    } else {
+        addFree(offset, length);
+    }
+}
+
+inline void SpillFile::clear() {
+    if (std::fflush(file) != 0 || ftruncate(fileno(file), 0) != 0) {
+        fail("truncate");
+    }
+    end = 0;
+    free_by_offset.clear();
+    free_by_length.clear();
+}
+
+inline uint64_t SpillFile::fileSize() const {
+    return end;
+}
+
+
+/** Private Method Implementations */
+inline void SpillFile::addFree(uint64_t offset, uint64_t length) {
+    free_by_offset[offset] = length;
+    free_by_length.insert(std::make_pair(length, offset));
+}
+
+inline void SpillFile::removeFree(uint64_t offset, uint64_t length) {
+    free_by_offset.erase(offset);
+    std::multimap<uint64_t, uint64_t>::iterator it = free_by_length.lower_bound(length);
+    while (it->second != offset) {
+        ++it;
+    }
+    free_by_length.erase(it);
+}
+
+inline void SpillFile::fail(const char* operation) {
+    throw std::runtime_error(std::string("SpillFile: failed to ") + operation + " " + path);
+}
+
+#endif // __SPILL_FILE__
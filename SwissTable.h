@@ -0,0 +1,330 @@
+//
+// SwissTable.h
+//
+// Open addressing hash index in the style of Abseil's Swiss tables. A
+// control byte per slot holds 7 bits of the key's hash, so a probe
+// compares a group of 16 slots against the hash at once and only reads
+// keys whose bits matched. Keys live in nodes that also cache their full
+// hash: growing the table never hashes a key again, and mapped values
+// never move.
+//
+//
+
+#ifndef __SWISS_TABLE__
+#define __SWISS_TABLE__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/** Node based Swiss table implementing the key index interface of KeyIndex.h, hashing keys with Hash. */
+template <typename K, typename T, typename Hash = std::hash<K>>
+class SwissTable {
+public:
+    /** Constructor. No memory is allocated until the first key is inserted. */
+    SwissTable();
+
+    SwissTable(SwissTable&& other) noexcept;
+
+    SwissTable(const SwissTable& other) = delete;
+
+    ~SwissTable();
+
+    SwissTable& operator=(SwissTable&& other) noexcept;
+
+    SwissTable& operator=(const SwissTable& other) = delete;
+
+    /** Returns the value mapped to key, or nullptr if there is none. */
+    T* find(const K& key);
+
+    /** Returns the value mapped to key, inserting a default constructed one if there is none. */
+    T& operator[](const K& key);
+
+    /** Removes key. Returns true if it was present. */
+    bool erase(const K& key);
+
+    /** Calls fn(key, value) for every key. fn must not insert or erase keys. */
+    template <typename F>
+    void forEach(F fn);
+
+    /** Returns the number of keys. */
+    size_t size() const;
+
+    /** Removes every key. */
+    void clear() noexcept;
+
+    /** Exchanges the contents of this index with other in constant time. */
+    void swap(SwissTable& other) noexcept;
+
+private:
+    struct Node {
+        Node(const K& key, size_t hash) : key(key), hash(hash), value() {}
+
+        K key;
+
+        /** Hash of key, kept so the table can grow without hashing keys again. */
+        size_t hash;
+
+        T value;
+    };
+
+    /** Slots compared by one probe. */
+    static const size_t kGroup = 16;
+
+    /** Control byte of a slot that has never held a key. Full slots hold 7 hash bits. */
+    static const uint8_t kEmpty = 0x80;
+
+    /** Control byte of a slot whose key was erased; probes continue past it. */
+    static const uint8_t kDeleted = 0xFE;
+
+    /** Returns key's hash, mixed so the bits in control bytes and those picking the group both vary. */
+    static size_t hashOf(const K& key);
+
+    /** Returns a bit per slot of the group at position whose control byte equals control. */
+    uint32_t match(size_t position, uint8_t control) const;
+
+    /** Returns the slot holding key, hashed to hash, or capacity if there is none. */
+    size_t findSlot(const K& key, size_t hash) const;
+
+    /** Returns the first empty or deleted slot on the probe sequence of hash. */
+    size_t findFreeSlot(size_t hash) const;
+
+    /** Inserts node, whose key must not be present, growing the table if need be. */
+    void adopt(Node* node);
+
+    /** Sets the control byte of slot, and its copy past the end of the array. */
+    void setControl(size_t slot, uint8_t control);
+
+    /** Moves every node into fresh arrays of new_capacity slots, dropping deleted slots. */
+    void rehash(size_t new_capacity);
+
+    /**
+     * Control bytes, followed by copies of the first kGroup so a group starting near the
+     * end can be loaded without wrapping.
+     */
+    uint8_t* controls;
+
+    Node** slots;
+
+    /** Number of slots, zero or a power of two of at least kGroup. */
+    size_t capacity;
+
+    size_t count;
+
+    /** Keys that can still be inserted into empty slots before the table must be rehashed. */
+    size_t growth_left;
+};
+
+
+/** Public Method implementations */
+template <typename K, typename T, typename Hash>
+SwissTable<K, T, Hash>::SwissTable() : controls(nullptr), slots(nullptr), capacity(0), count(0), growth_left(0) {}
+
+template <typename K, typename T, typename Hash>
+SwissTable<K, T, Hash>::SwissTable(SwissTable&& other) noexcept
+    : controls(other.controls), slots(other.slots), capacity(other.capacity),
+      count(other.count), growth_left(other.growth_left) {
+    other.controls = nullptr;
+    other.slots = nullptr;
+    other.capacity = 0;
+    other.count = 0;
+    other.growth_left = 0;
+}
+
+template <typename K, typename T, typename Hash>
+SwissTable<K, T, Hash>::~SwissTable() {
+    clear();
+}
+
+template <typename K, typename T, typename Hash>
+SwissTable<K, T, Hash>& SwissTable<K, T, Hash>::operator=(SwissTable&& other) noexcept {
+    SwissTable(std::move(other)).swap(*this);
+    return *this;
+}
+
+template <typename K, typename T, typename Hash>
+T* SwissTable<K, T, Hash>::find(const K& key) {
+    if (count == 0) {
+        return nullptr;
+    }
+    size_t slot = findSlot(key, hashOf(key));
+    return slot == capacity ? nullptr : &slots[slot]->value;
+}
+
+template <typename K, typename T, typename Hash>
+T& SwissTable<K, T, Hash>::operator[](const K& key) {
+    size_t hash = hashOf(key);
+    if (count > 0) {
+        size_t slot = findSlot(key, hash);
+        if (slot != capacity) {
+            return slots[slot]->value;
+        }
+    }
+    Node* node = new Node(key, hash);
+    adopt(node);
+    return node->value;
+}
+
+template <typename K, typename T, typename Hash>
+bool SwissTable<K, T, Hash>::erase(const K& key) {
+    if (count == 0) {
+        return false;
+    }
+    size_t slot = findSlot(key, hashOf(key));
+    if (slot == capacity) {
+        return false;
+    }
+    delete slots[slot];
+    slots[slot] = nullptr;
+    setControl(slot, kDeleted);
+    --count;
+    return true;
+}
+
+template <typename K, typename T, typename Hash>
+template <typename F>
+void SwissTable<K, T, Hash>::forEach(F fn) {
+    for (size_t slot = 0; slot < capacity; ++slot) {
+        if (controls[slot] < kEmpty) {
+            fn(static_cast<const K&>(slots[slot]->key), slots[slot]->value);
+        }
+    }
+}
+
+template <typename K, typename T, typename Hash>
+size_t SwissTable<K, T, Hash>::size() const {
+    return count;
+}
+
+template <typename K, typename T, typename Hash>
+void SwissTable<K, T, Hash>::clear() noexcept {
+    for (size_t slot = 0; slot < capacity; ++slot) {
+        if (controls[slot] < kEmpty) {
+            delete slots[slot];
+        }
+    }
+    delete[] controls;
+    delete[] slots;
+    controls = nullptr;
+    slots = nullptr;
+    capacity = 0;
+    count = 0;
+    growth_left = 0;
+}
+
+template <typename K, typename T, typename Hash>
+void SwissTable<K, T, Hash>::swap(SwissTable& other) noexcept {
+    std::swap(controls, other.controls);
+    std::swap(slots, other.slots);
+    std::swap(capacity, other.capacity);
+    std::swap(count, other.count);
+    std::swap(growth_left, other.growth_left);
+}
+
+
+/** Private Method Implementations */
+template <typename K, typename T, typename Hash>
+size_t SwissTable<K, T, Hash>::hashOf(const K& key) {
+    uint64_t hash = static_cast<uint64_t>(Hash()(key));
+    // std::hash of an integer is the integer itself; spread it over every bit
+    hash *= 0x9E3779B97F4A7C15ULL;
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+template <typename K, typename T, typename Hash>
+uint32_t SwissTable<K, T, Hash>::match(size_t position, uint8_t control) const {
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(controls + position));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(control))));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroup; ++i) {
+        mask |= uint32_t(controls[position + i] == control) << i;
+    }
+    return mask;
+#endif
+}
+
+template <typename K, typename T, typename Hash>
+size_t SwissTable<K, T, Hash>::findSlot(const K& key, size_t hash) const {
+    size_t position = (hash >> 7) & (capacity - 1);
+    for (size_t step = kGroup; ; step += kGroup) {
+        for (uint32_t mask = match(position, hash & 0x7F); mask; mask &= mask - 1) {
+            size_t slot = (position + __builtin_ctz(mask)) & (capacity - 1);
+            if (slots[slot]->hash == hash && slots[slot]->key == key) {
+                return slot;
+            }
+        }
+        if (match(position, kEmpty)) {
+            return capacity;
+        }
+        position = (position + step) & (capacity - 1);
+    }
+}
+
+template <typename K, typename T, typename Hash>
+size_t SwissTable<K, T, Hash>::findFreeSlot(size_t hash) const {
+    size_t position = (hash >> 7) & (capacity - 1);
+    for (size_t step = kGroup; ; step += kGroup) {
+        // both free markers have the high bit set, which full slots never do
+        uint32_t mask = match(position, kEmpty) | match(position, kDeleted);
+        if (mask) {
+            return (position + __builtin_ctz(mask)) & (capacity - 1);
+        }
+        position = (position + step) & (capacity - 1);
+    }
+}
+
+template <typename K, typename T, typename Hash>
+void SwissTable<K, T, Hash>::adopt(Node* node) {
+    if (growth_left == 0) {
+        // deleted slots are reclaimed in place while they make up over half the load
+        rehash(capacity == 0 ? kGroup : count * 2 < capacity * 7 / 16 ? capacity : capacity * 2);
+    }
+    size_t slot = findFreeSlot(node->hash);
+    if (controls[slot] == kEmpty) {
+        --growth_left;
+    }
+    slots[slot] = node;
+    setControl(slot, node->hash & 0x7F);
+    ++count;
+}
+
+template <typename K, typename T, typename Hash>
+void SwissTable<K, T, Hash>::setControl(size_t slot, uint8_t control) {
+    controls[slot] = control;
+    if (slot < kGroup) {
+        controls[capacity + slot] = control;
+    }
+}
+
+template <typename K, typename T, typename Hash>
+void SwissTable<K, T, Hash>::rehash(size_t new_capacity) {
+    uint8_t* old_controls = controls;
+    Node** old_slots = slots;
+    size_t old_capacity = capacity;
+
+    controls = new uint8_t[new_capacity + kGroup];
+    std::memset(controls, kEmpty, new_capacity + kGroup);
+    slots = new Node*[new_capacity];
+    capacity = new_capacity;
+    growth_left = new_capacity * 7 / 8 - count;
+    for (size_t slot = 0; slot < old_capacity; ++slot) {
+        if (old_controls[slot] < kEmpty) {
+            Node* node = old_slots[slot];
+            size_t free_slot = findFreeSlot(node->hash);
+            slots[free_slot] = node;
+            setControl(free_slot, node->hash & 0x7F);
+        }
+    }
+    delete[] old_controls;
+    delete[] old_slots;
+}
+
+#endif // __SWISS_TABLE__
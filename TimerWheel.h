@@ -0,0 +1,134 @@
+//
+// TimerWheel.h
+//
+// A hashed timing wheel. Items are scheduled for an integer tick and
+// handed back once the wheel is advanced past that tick, with work
+// proportional to the number of items that expire.
+//
+//
+
+#ifndef __TIMER_WHEEL__
+#define __TIMER_WHEEL__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+using std::vector;
+
+/** Timing wheel of items of type T scheduled by tick. */
+template <typename T>
+class TimerWheel {
+public:
+    /** Constructor. The wheel starts at tick now and directly covers slot_count ticks ahead. */
+    explicit TimerWheel(uint64_t now, size_t slot_count = 256);
+
+    /** Schedules item to expire at tick. Ticks not after the current one expire on the next advance. */
+    void schedule(uint64_t tick, T item);
+
+    /** Moves the wheel to tick, calling expire(item) for every item scheduled at or before it. */
+    template <typename F>
+    void advance(uint64_t tick, F expire);
+
+    /** Returns the tick the wheel was last advanced to. */
+    uint64_t now() const;
+
+    /** Returns the number of items scheduled but not yet expired. */
+    size_t pending() const;
+
+private:
+    /** Item scheduled beyond the ticks the slots cover. */
+    struct Deferred {
+        uint64_t tick;
+        T item;
+
+        bool operator>(const Deferred& other) const {
+            return tick > other.tick;
+        }
+    };
+
+    /** Moves deferred items that now fall within the slots into them. */
+    void cascade();
+
+    /** slots[tick % slots.size()] holds the items of tick, for ticks in (current, current + slots.size()]. */
+    vector<vector<T>> slots;
+
+    /** Items too far ahead for the slots, earliest first. */
+    std::priority_queue<Deferred, vector<Deferred>, std::greater<Deferred>> deferred;
+
+    /** Tick the wheel was last advanced to. */
+    uint64_t current;
+
+    /** Number of items in slots and deferred. */
+    size_t item_count;
+};
+
+
+/** Public Method implementations */
+template <typename T>
+TimerWheel<T>::TimerWheel(uint64_t now, size_t slot_count)
+    : slots(slot_count == 0 ? 1 : slot_count), current(now), item_count(0) {}
+
+template <typename T>
+void TimerWheel<T>::schedule(uint64_t tick, T item) {
+    if (tick <= current) {
+        tick = current + 1;
+    }
+    if (tick - current <= slots.size()) {
+        slots[tick % slots.size()].push_back(std::move(item));
+    } else {
+        deferred.push(Deferred{ tick, std::move(item) });
+    }
+    ++item_count;
+}
+
+template <typename T>
+template <typename F>
+void TimerWheel<T>::advance(uint64_t tick, F expire) {
+    if (tick <= current) {
+        return;
+    }
+    // a jump past the whole wheel expires every slot once
+    uint64_t last = tick - current < slots.size() ? tick : current + slots.size();
+    for (uint64_t t = current + 1; t <= last; ++t) {
+        vector<T> due;
+        due.swap(slots[t % slots.size()]);
+        item_count -= due.size();
+        for (T& item : due) {
+            expire(item);
+        }
+    }
+    while (!deferred.empty() && deferred.top().tick <= tick) {
+        T item = deferred.top().item;
+        deferred.pop();
+        --item_count;
+        expire(item);
+    }
+    current = tick;
+    cascade();
+}
+
+template <typename T>
+uint64_t TimerWheel<T>::now() const {
+    return current;
+}
+
+template <typename T>
+size_t TimerWheel<T>::pending() const {
+    return item_count;
+}
+
+
+/** Private Method Implementations */
+template <typename T>
+void TimerWheel<T>::cascade() {
+    while (!deferred.empty() && deferred.top().tick - current <= slots.size()) {
+        const Deferred& next = deferred.top();
+        slots[next.tick % slots.size()].push_back(next.item);
+        deferred.pop();
+    }
+}
+
+#endif // __TIMER_WHEEL__
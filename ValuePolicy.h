@@ -0,0 +1,122 @@
+//
+// ValuePolicy.h
+//
+// Policies deciding how VersionedKvStore diffs hold their values.
+// FullValues keeps every value as is. DeltaStrings keeps string values
+// of older diffs as deltas against the next newer diff, with periodic
+// full keyframes bounding the cost of rebuilding a value.
+//
+//
+
+#ifndef __VALUE_POLICY__
+#define __VALUE_POLICY__
+
+#include "Delta.h"
+#include "Serializer.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+/** Value policy storing every value in full. */
+template <typename V>
+struct FullValues {
+    /** What a diff holds for its value. */
+    typedef V Stored;
+
+    /** Returns the value held by stored, which must hold it in full. */
+    static const V& full(const Stored& stored) {
+        return stored;
+    }
+
+    /** Makes stored hold value in full. */
+    static void assign(Stored& stored, V value) {
+        stored = std::move(value);
+    }
+
+    /** Returns true if stored holds its value in full. */
+    static bool isFull(const Stored&) {
+        return true;
+    }
+
+    /**
+     * Called once newer, the value of the next diff up the chain, can no longer change.
+     * older_prev is what the diff below older holds, or nullptr. May re-encode older.
+     */
+    static void seal(Stored& /* older */, const Stored* /* older_prev */, const V& /* newer */) {}
+
+    /** Returns the value held by older given newer, the value of the next diff up the chain. */
+    static V decode(const Stored& older, const V& /* newer */) {
+        return older;
+    }
+};
+
+/** What a diff holds under DeltaStrings. */
+struct DeltaEncoded {
+    /** The value in full, or a delta against the value of the next diff up the chain. */
+    std::string bytes;
+
+    /** 0 if bytes is a full value, otherwise the number of consecutive deltas ending here, counted from below. */
+    uint32_t run;
+};
+
+/**
+ * Value policy for std::string values storing older values as deltas. At most
+ * KeyframeInterval - 1 deltas separate two full values, so a historical read
+ * applies at most that many deltas.
+ */
+template <unsigned KeyframeInterval = 16>
+struct DeltaStrings {
+    typedef DeltaEncoded Stored;
+
+    static const std::string& full(const Stored& stored) {
+        return stored.bytes;
+    }
+
+    static void assign(Stored& stored, std::string value) {
+        stored.bytes = std::move(value);
+        stored.run = 0;
+    }
+
+    static bool isFull(const Stored& stored) {
+        return stored.run == 0;
+    }
+
+    static void seal(Stored& older, const Stored* older_prev, const std::string& newer) {
+        if (older.run != 0) {
+            // already encoded against this newer value
+            return;
+        }
+        uint32_t run = (older_prev ? older_prev->run : 0) + 1;
+        if (run >= KeyframeInterval) {
+            return;
+        }
+        std::string encoded = DeltaCodec::encode(newer, older.bytes);
+        if (encoded.size() < older.bytes.size()) {
+            older.bytes = std::move(encoded);
+            older.run = run;
+        }
+    }
+
+    static std::string decode(const Stored& older, const std::string& newer) {
+        return DeltaCodec::apply(newer, older.bytes);
+    }
+};
+
+/** Serializer for DeltaEncoded, so stores using DeltaStrings can spill. */
+template <>
+struct Serializer<DeltaEncoded> {
+    static void write(std::string& out, const DeltaEncoded& value) {
+        Serializer<std::string>::write(out, value.bytes);
+        Serializer<uint32_t>::write(out, value.run);
+    }
+
+    static DeltaEncoded read(const char*& in) {
+        DeltaEncoded value;
+        value.bytes = Serializer<std::string>::read(in);
+        value.run = Serializer<uint32_t>::read(in);
+        return value;
+    }
+};
+
+#endif // __VALUE_POLICY__
@@ -12,21 +12,253 @@
 #ifndef __VERSIONED_KV_STORE__
 #define __VERSIONED_KV_STORE__
 
+#include "ChangeLog.h"
+#include "Lifetime.h"
+#include "Policy.h"
+#include "RingBuffer.h"
+#include "Serializer.h"
+#include "SmallVector.h"
+#include "SpillFile.h"
+#include "TimerWheel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 using std::unordered_map;
+using std::unordered_set;
 using std::vector;
 
-/** Key value store data structure that supports snapshots. */
-template <typename K, typename V>
+/** 
+ * Key value store data structure that supports snapshots. Policy selects, at 
+ * compile time, how values, keys and diffs are stored and whether operations 
+ * lock; see Policy.h for the presets.
+ */
+template <typename K, typename V, typename Policy = DefaultPolicy>
 class VersionedKvStore {
+    /** Per key state held in key_value_store, defined below. */
+    struct Entry;
+
 public:
+    /** State of a single key after the version it changed in. */
+    struct Change {
+        K key;
+        bool deleted;
+        V value;
+    };
+
+    /** Every key that changed in one saved version. */
+    struct ChangeSet {
+        unsigned version;
+
+        /** True if the store was cleared before these changes, so keys not listed are absent. */
+        bool cleared;
+
+        vector<Change> changes;
+    };
+
+    /** Change sets are shared between all feeds they are delivered to. */
+    typedef std::shared_ptr<const ChangeSet> ChangeSetPtr;
+
+    /** Versions [created, erased) a key was alive in. erased is kStillAlive if the key exists now. */
+    struct Interval {
+        unsigned created;
+        unsigned erased;
+    };
+
+    /** Interval::erased of a key that has not been erased since its last creation. */
+    static const unsigned kStillAlive = UINT_MAX;
+
+    /** Counters describing how the store holds its history, see stats(). */
+    struct Stats {
+        /** Keys in the key index, including keys currently erased. */
+        size_t keys;
+
+        /** Keys whose history is read by walking prev_diff, including spilled keys. */
+        size_t listed_keys;
+
+        /** Keys whose history is also indexed by version. */
+        size_t indexed_keys;
+
+        /** Diffs held in memory. */
+        size_t resident_diffs;
+
+        /** Bytes of the spill file in use, including free space left by chains read back. */
+        uint64_t spill_file_bytes;
+    };
+
+    /** One tier of a retention policy, see setRetention(). */
+    struct RetentionTier {
+        /** The tier covers versions saved more than age versions ago. */
+        unsigned age;
+
+        /** Only one version of every stride consecutive versions is kept. */
+        unsigned stride;
+    };
+
+    /** Log of the change set of every saved version, see enableChangeLog(). */
+    typedef ChangeLog<ChangeSetPtr> ChangeSetLog;
+
+    /** 
+     * Consumer end of a subscription. The store pushes a change set on each save() 
+     * and a single consumer thread pops them with poll().
+     */
+    class ChangeFeed {
+    public:
+        /** Constructor. Use VersionedKvStore::subscribe() instead. */
+        ChangeFeed(size_t capacity, bool include_values);
+
+        /** Pops the oldest undelivered change set. Returns false if none is pending. */
+        bool poll(ChangeSetPtr& change_set);
+
+        /** 
+         * Returns the number of change sets dropped because the feed was full. 
+         * Consumers seeing this grow should rescan the store.
+         */
+        size_t dropped() const;
+
+    private:
+        friend class VersionedKvStore;
+
+        /** Change sets waiting for the consumer. */
+        SpscRingBuffer<ChangeSetPtr> pending;
+
+        /** True if changes carry their new values. */
+        bool include_values;
+
+        /** Number of change sets that did not fit in pending. */
+        std::atomic<size_t> dropped_count;
+    };
+
+    /** 
+     * Optimistic transaction. Reads see the store as of the most recently saved 
+     * version and writes are buffered until commit(), which applies them to the 
+     * current version only if no key read or written has changed since that 
+     * snapshot. The store must outlive the transaction and not be moved or cleared.
+     */
+    class Transaction {
+    public:
+        /** Returns true if value exists for key, including writes made by this transaction. */
+        bool exists(K key);
+
+        /** Gets value for key, including writes made by this transaction. */
+        V get(K key);
+
+        /** Buffers setting value for key. */
+        void set(K key, V value);
+
+        /** Buffers deleting the value stored for key. */
+        void erase(K key);
+
+        /** 
+         * Applies the buffered writes if no key read or written has a diff newer than 
+         * the snapshot. Returns false, discarding the writes, on conflict. 
+         */
+        bool commit();
+
+    private:
+        friend class VersionedKvStore;
+
+        /** Buffered write. */
+        struct Write {
+            bool deleted;
+            V value;
+        };
+
+        Transaction(VersionedKvStore& store);
+
+        /** 
+         * Returns true if key was written after the snapshot, even if that version was since 
+         * squashed, or may have been before versions after the snapshot were released.
+         */
+        bool conflicts(const K& key);
+
+        VersionedKvStore* store;
+
+        /** False if nothing had been saved when the transaction began, so the snapshot is empty. */
+        bool has_snapshot;
+
+        /** Version reads are served from. */
+        unsigned snapshot;
+
+        unordered_set<K> reads;
+
+        unordered_map<K, Write> writes;
+    };
+
+    /** 
+     * Direct reference to the state of one key, so reads and writes through it skip 
+     * hashing and probing. Only stores whose key index never moves entries, see MovesValues 
+     * in KeyIndex.h, and whose entries are not slim have handles, so a handle stays valid 
+     * as the index grows, and its key is not removed by releaseVersionsBefore() or 
+     * squash() while any handle to it exists. The store must outlive the handle and 
+     * not be moved or cleared.
+     */
+    class KeyHandle {
+    public:
+        KeyHandle(const KeyHandle& other);
+
+        KeyHandle& operator=(KeyHandle other);
+
+        ~KeyHandle();
+
+    private:
+        friend class VersionedKvStore;
+
+        /** Constructor. Use VersionedKvStore::handle() instead. */
+        KeyHandle(VersionedKvStore& store, K key, Entry& entry);
+
+        VersionedKvStore* store;
+
+        K key;
+
+        Entry* entry;
+    };
+
     /** Constructor. */
     VersionedKvStore();
 
+    /** 
+     * Move constructor. Takes ownership of other's diffs without copying them or 
+     * allocating. The moved-from store is left empty at version 0.
+     */
+    VersionedKvStore(VersionedKvStore&& other) noexcept;
+
+    /** Copying would share ownership of the diffs, so it is disabled. */
+    VersionedKvStore(const VersionedKvStore& other) = delete;
+
     /** Destructor. */
     ~VersionedKvStore();
 
+    /** Move assignment. Releases the diffs currently held and takes ownership of other's. */
+    VersionedKvStore& operator=(VersionedKvStore&& other) noexcept;
+
+    /** Copying would share ownership of the diffs, so it is disabled. */
+    VersionedKvStore& operator=(const VersionedKvStore& other) = delete;
+
+    /** Exchanges the contents of this store with other in constant time, holding both locks. */
+    void swap(VersionedKvStore& other) noexcept;
+
+    /** 
+     * Empties the store, resetting it to version 0, and frees the previous contents 
+     * on a background thread. Returns that thread so the caller can join or detach it. 
+     * Feeds, the change log and the spill and retention settings stay in force: the 
+     * next change set is marked cleared and change log readers must resync.
+     */
+    std::thread clearAsync();
+
     /** Deletes the value stored for key. */
     void erase(K key);
 
@@ -45,15 +277,80 @@ public:
      */
     V get(K key, unsigned version_num);
 
+    /** Returns a handle to key, which need not exist yet. */
+    KeyHandle handle(K key);
+
+    /** Gets the value for the key of handle. Returns default value for typename V if none is set. */
+    V get(const KeyHandle& handle);
+
+    /** Returns the value for the key of handle in the snapshot corresponding to version_num. */
+    V get(const KeyHandle& handle, unsigned version_num);
+
+    /** Sets value for the key of handle. */
+    void set(const KeyHandle& handle, V value);
+
+    /** Returns the intervals in which a value existed for key, oldest first. */
+    vector<Interval> aliveIntervals(K key);
+
     /** Returns the current version number of the key value store. Version number starts at 0. */
     unsigned maxVersion();
 
     /** Sets value for key. */
     void set(K key, V value);
 
+    /** 
+     * Sets value for key unless that would exceed the kMaxKeys, kMaxDiffs or kMaxToggles 
+     * of the policy. Returns false, leaving the store unchanged, if it would.
+     */
+    bool trySet(K key, V value);
+
+    /** 
+     * Deletes the value stored for key unless that would exceed the limits of the policy. 
+     * Returns false, leaving the store unchanged, if it would.
+     */
+    bool tryErase(K key);
+
+    /** 
+     * Sets value for key to desired if key currently exists with value expected and the 
+     * write stays within the limits of the policy. Returns true if the value was set.
+     */
+    bool compareAndSet(K key, const V& expected, V desired);
+
+    /** 
+     * Replaces the value for key with fn(current value) if key exists and the write stays 
+     * within the limits of the policy. Returns true if the value was replaced.
+     */
+    template <typename F>
+    bool update(K key, F fn);
+
+    /** 
+     * Sets value for key to fn(current value) if key exists, or to initial otherwise. 
+     * Returns the value stored.
+     */
+    template <typename F>
+    V upsert(K key, V initial, F fn);
+
+    /** 
+     * Sets value for key, expiring it after ttl_versions saves: the key is absent 
+     * from the version that many saves later onwards. A ttl of 0 behaves like 1.
+     */
+    void set(K key, V value, unsigned ttl_versions);
+
+    /** 
+     * Sets value for key, expiring it once ttl has elapsed. Expiry is evaluated on 
+     * save(), so the key is absent from the first version saved after the deadline.
+     */
+    void set(K key, V value, std::chrono::seconds ttl);
+
     /** Returns size of key value store. */
     size_t size();
 
+    /** 
+     * Returns how many of keys existed in the snapshot for version_num, counting 
+     * a key listed twice twice. Reads only the key lifetimes. 
+     */
+    size_t size(const vector<K>& keys, unsigned version_num);
+
     /** 
     * Returns size of key value store for specific version. 
     * Returns size of current key value store if no such snapshot for version_num is found.
@@ -61,204 +358,1973 @@ public:
     size_t size(unsigned version_num);
 
     /** 
-     * Saves snapshot of current key value store state. 
+     * Saves snapshot of current key value store state. Stores with Policy::kMaxVersions
+     * holding that many versions first reuse the bookkeeping of released versions, 
+     * releasing the oldest version if none has been.
      * Returns corresponding version number for the snapshot. 
      */
     unsigned save();
 
+    /** 
+     * Registers a feed receiving the keys changed by every subsequent save(). 
+     * At most capacity change sets are buffered; later ones are dropped until the 
+     * consumer catches up. New values are included only if include_values is true.
+     */
+    std::shared_ptr<ChangeFeed> subscribe(size_t capacity = 1024, bool include_values = false);
+
+    /** Stops delivering change sets to feed. */
+    void unsubscribe(const std::shared_ptr<ChangeFeed>& feed);
+
+    /** 
+     * Starts logging the change set, with values, of every version saved from now on. 
+     * At most capacity versions are held; backpressure decides whether save() then 
+     * waits for slow readers or drops the oldest version, forcing those readers to resync. 
+     * save() waits after releasing the store's lock, so readers may read the store 
+     * before advancing; the caller of save() must not hold anything they wait on.
+     */
+    void enableChangeLog(size_t capacity, typename ChangeSetLog::Backpressure backpressure);
+
+    /** Stops logging. Attached readers can still drain what was logged. */
+    void disableChangeLog();
+
+    /** 
+     * Returns a reader tailing the change log from version from_version onwards. 
+     * Returns nullptr if the change log is not enabled.
+     */
+    std::shared_ptr<typename ChangeSetLog::Reader> tailChanges(unsigned from_version);
+
+    /** 
+     * Bounds the number of diffs held in memory to max_resident_diffs. Chains of 
+     * keys not accessed recently are moved to a spill file at spill_path and read 
+     * back when next accessed. V must have a Serializer. The file is removed when 
+     * spilling is disabled or the store is destroyed. Stores with slim entries or a key 
+     * index that moves entries cannot spill.
+     */
+    void enableSpill(size_t max_resident_diffs, const std::string& spill_path);
+
+    /** Reads every spilled chain back into memory and stops spilling. */
+    void disableSpill();
+
+    /** Returns the number of diffs currently held in memory. */
+    size_t residentDiffs();
+
+    /** Returns counters describing the representation of every key's history. */
+    Stats stats();
+
+    /** Begins an optimistic transaction reading from the most recently saved version. */
+    Transaction beginTransaction();
+
+    /** 
+     * Declares that versions before version will no longer be read, capped at the most 
+     * recently saved version. Diffs only those versions could see are freed, and keys 
+     * absent from every retained version are removed outright. Reads of released 
+     * versions, other than size(), may then answer as if keys were absent. Stores
+     * with Policy::kMaxVersions reuse the bookkeeping of released versions, after
+     * which size() answers 0 for them.
+     * Returns the number of keys removed.
+     */
+    size_t releaseVersionsBefore(unsigned version);
+
+    /** Returns the oldest version still retained. */
+    unsigned oldestRetainedVersion();
+
+    /** 
+     * Collapses the saved versions from to to into one holding the state of to, freeing 
+     * the diffs in between. Version numbers are never reused: reads at any version in the 
+     * range see the state of the range's last version, see translateVersion(). A range 
+     * overlapping an earlier squash is widened to cover it. Costs one pass over the keys 
+     * plus the diffs in the range.
+     */
+    void squash(unsigned from, unsigned to);
+
+    /** Returns the version whose state reads at version_num are answered from. */
+    unsigned translateVersion(unsigned version_num);
+
+    /** 
+     * Downsamples old versions as save() advances. Once versions are older than a tier's 
+     * age, each aligned group of stride of them is squashed into its last version, e.g. 
+     * tiers {1000, 100} and {1000000, 10000} keep every version of the last 1000, every 
+     * 100th of the last million and every 10000th beyond. Strides should be multiples of 
+     * the strides of younger tiers, since a group straddling an older squash is widened 
+     * to cover it. Groups are squashed as soon as they have wholly aged, the groups of 
+     * every tier in one pass over the keys. Versions already past a tier's age are 
+     * squashed straight away. An empty list stops downsampling; versions already 
+     * squashed stay so.
+     */
+    void setRetention(vector<RetentionTier> tiers);
+
 private:
+    /** How diffs hold values, see ValuePolicy.h. */
+    typedef typename Policy::template Values<V> ValuePolicy;
+
+    /** How keys are indexed, see KeyIndex.h. */
+    typedef typename Policy::template KeyIndex<K, Entry> KeyIndexType;
+
+    /** Held by every public operation for the duration of the call. */
+    typedef std::lock_guard<typename Policy::Locking> Guard;
+
+    /** 
+     * True if the policy bounds keys or diffs. Operations that would need room but 
+     * cannot report a full store then fail to compile.
+     */
+    static constexpr bool kBounded = Policy::kMaxKeys != SIZE_MAX || Policy::kMaxDiffs != SIZE_MAX;
+
+    /** 
+     * True if the key index may move entries, see MovesValues in KeyIndex.h. Nothing may 
+     * then point at entries, so handles and spilling fail to compile.
+     */
+    static constexpr bool kMovingEntries = MovesValues<KeyIndexType>::value;
+
     /** Structure to hold diff for snapshot. */
     struct Diff {
-        bool deleted;
         Diff* prev_diff;
         unsigned version;
-        V value; 
+        bool deleted;
+        bool recorded;
+        typename ValuePolicy::Stored value; 
+    };
+
+    /** Per key state every store keeps, all of an entry if Policy::kSlimEntries is set. */
+    struct SlimEntry {
+        SlimEntry() : head(nullptr), written(0) {}
+
+        /** Most recent diff, or nullptr while the chain is spilled. */
+        Diff* head;
+
+        /** 
+         * Version the key was last set or erased in. Unlike head->version it is not lowered 
+         * by squash(), and it stays in memory while the chain is spilled.
+         */
+        unsigned written;
+
+        /** Versions the key was alive in. Stays in memory while the chain is spilled. */
+        BasicLifetime<Policy::kInlineToggles> lifetime;
+    };
+
+    /** Per key state of stores that may spill, hand out KeyHandles and index long histories. */
+    struct FullEntry : SlimEntry {
+        FullEntry() 
+            : spill_offset(kNotSpilled), 
+              clock_slot(0), 
+              chain_length(0), 
+              handles(0), 
+              referenced(false) {}
+
+        /** Offset of the chain in the spill file, or kNotSpilled. */
+        uint64_t spill_offset;
+
+        /** Position in Spill::clock while resident and spilling is enabled. */
+        unsigned clock_slot;
+
+        /** Number of diffs in the chain, resident or not. */
+        unsigned chain_length;
+
+        /** Number of KeyHandles to the entry. An entry with handles is never removed from key_value_store. */
+        unsigned handles;
+
+        /** CLOCK reference bit, set on access while spilling is enabled. */
+        bool referenced;
+
+        /** The resident chain oldest first, once it is long enough to be worth indexing. */
+        std::unique_ptr<vector<Diff*>> history;
+    };
+
+    /** Per key state held in key_value_store. */
+    struct Entry : std::conditional<Policy::kSlimEntries, SlimEntry, FullEntry>::type {};
+
+    /** spill_offset of entries whose chain is in memory. */
+    static const uint64_t kNotSpilled = UINT64_MAX;
+
+    /** Spilling state, only allocated while a memory bound is in force. */
+    struct Spill {
+        Spill(size_t max_resident_diffs, const std::string& path)
+            : file(path), max_resident_diffs(max_resident_diffs), hand(0) {}
+
+        SpillFile file;
+
+        size_t max_resident_diffs;
+
+        /** Entries with a chain in memory, swept by the CLOCK hand to pick eviction victims. */
+        vector<Entry*> clock;
+
+        /** Position of the CLOCK hand in clock. */
+        size_t hand;
+    };
+
+    /** When a key set with a ttl expires. */
+    struct Deadline {
+        bool by_time;
+        uint64_t tick;
+    };
+
+    /** Expiry state, only allocated once a key has been set with a ttl. */
+    struct Expiry {
+        explicit Expiry(uint64_t now_second) : by_version(0), by_time(now_second) {}
+
+        /** Keys keyed by the version they expire in. */
+        TimerWheel<K> by_version;
+
+        /** Keys keyed by the second they expire at. */
+        TimerWheel<K> by_time;
+
+        /** Deadline currently in force per key. Wheel entries not matching it are stale. */
+        unordered_map<K, Deadline> deadlines;
+    };
+
+    /** Bookkeeping for change feeds and the change log, only allocated while either is in use. */
+    struct ChangeCapture {
+        vector<std::shared_ptr<ChangeFeed>> feeds;
+
+        std::shared_ptr<ChangeSetLog> log;
+
+        /** Keys changed in the current version, possibly with duplicates. */
+        vector<K> changed_keys;
+
+        /** True if the store was cleared since the last change set was published. */
+        bool cleared;
+    };
+
+    /** Retention policy state, only allocated while tiers are in force. */
+    struct Retention {
+        /** Tiers ordered by age. */
+        vector<RetentionTier> tiers;
+
+        /** Per tier, versions before this one have already been squashed to the tier's stride. */
+        vector<unsigned> squashed_until;
+    };
+
+    /** Bookkeeping of squash() and releaseVersionsBefore(), only allocated once either is used. */
+    struct Compaction {
+        /** 
+         * First version of each slot of sizes, then the current version. Empty until the first 
+         * squash(), while each slot holds a single version.
+         */
+        vector<unsigned> slot_starts;
+
+        /** 
+         * Keys found to be removable during a pass over key_value_store, which cannot be erased 
+         * from while it is visited. Kept between passes to reuse its memory.
+         */
+        vector<K> removed_keys;
     };
 
+    /** Moves the contents of other, whose lock the caller holds through guard, leaving it empty at version 0. */
+    VersionedKvStore(VersionedKvStore& other, const Guard& guard) noexcept;
+
     /** Instantiates new diff structure for current key value store version. */
     Diff* newDiff();
 
+    /** Destroys diff, which must no longer be referenced. */
+    void deleteDiff(Diff* diff);
+
+    /** Sets value in entry, the entry for key, in the current version. */
+    void setEntry(const K& key, Entry& entry, V value);
+
+    /** Erases the value of entry, the entry for key, in the current version. */
+    void eraseEntry(const K& key, Entry& entry);
+
+    /** Returns the value of entry at version_num, or a default value if it was absent then. */
+    V valueAt(Entry& entry, unsigned version_num);
+
+    /** 
+     * Returns true if leaving entry, or a key with no entry if it is nullptr, alive or not 
+     * in the current version stays within the limits of the policy.
+     */
+    bool hasRoom(Entry* entry, bool alive);
+
+    /** Returns the entry for key, reading its chain back if it was spilled. Returns nullptr if none exists. */
+    Entry* findEntry(const K& key);
+
+    /** Returns the entry for key, creating an empty one if none exists. */
+    Entry& entryFor(const K& key);
+
     /** 
-     * Checks for redundancy between diff and its previous diff for given key. 
+     * Checks for redundancy between the head diff of entry and its previous diff. 
      * Deletes redundant diff if it exists.
      */
-    void checkAndDeleteRedundantDiff(K key);
+    void checkAndDeleteRedundantDiff(Entry& entry);
+
+    /** 
+     * Lets the value policy re-encode the diff below sealed, now that sealed has 
+     * been superseded and can no longer change. 
+     */
+    void sealHistory(Diff* sealed);
+
+    /** Returns the value held by target, a diff in the chain of entry. */
+    V valueOf(Entry& entry, Diff* target);
 
     /** Returns true if d1 and d2 hold equivalent state information about the key value store. */
     bool diffsEqual(Diff* d1, Diff* d2);
 
     /** 
-     * Returns latest version of diff for key not greater than version_num. 
+     * Returns latest version of diff in the chain of entry not greater than version_num. 
      * Returns nullptr if no such diff exists. 
      */
-    Diff* traverseToVersion(K key, int version_num);
+    Diff* traverseToVersion(Entry& entry, unsigned version_num);
 
-    /** Hash table of diffs. */
-    unordered_map<K, Diff*> key_value_store;
+    /** Records that a new diff was linked in as the head of entry. */
+    void pushHistory(Entry& entry);
 
-    /** Number of key value pairs for each saved version of the key value store. */
-    vector<size_t> sizes;
-};
+    /** Records that the head diff of entry was unlinked. */
+    void popHistory(Entry& entry);
 
+    /** Recounts the resident chain of entry, then indexes it or drops its index as its length warrants. */
+    void rebuildHistory(Entry& entry);
 
-/** Public Method implementations */
-template <typename K, typename V>
-VersionedKvStore<K, V>::VersionedKvStore() {
-    sizes.push_back(0);
-}
+    /** Returns the version index of the chain of entry, or nullptr if it is not indexed. */
+    static vector<Diff*>* historyIndex(Entry& entry);
 
-template <typename K, typename V>
-VersionedKvStore<K, V>::~VersionedKvStore() {
-    vector<Diff*> garbage;
-    for (auto it = key_value_store.begin(); it != key_value_store.end(); ++it) {
-        Diff* diff = it->second;
-        while (diff) {
-            garbage.push_back(diff);
-            diff = diff->prev_diff;
-        }
-    }
-    for (Diff* diff : garbage) {
-        delete diff;
-    }
-}
+    /** Frees the diffs of entry that no retained version can see. */
+    void pruneHistory(Entry& entry);
 
-template <typename K, typename V>
-void VersionedKvStore<K, V>::erase(K key) {
-    if (!key_value_store[key]) {
-        // key previously not instantiated
-        return;
-    } else if (key_value_store[key]->version != maxVersion()) {
-        // key exists but not for current version
-        Diff* diff = newDiff();
-        diff->deleted = true;
-        diff->prev_diff = key_value_store[key];
-        key_value_store[key] = diff;
-    } else {
-        // key exists for current version
-        key_value_store[key]->deleted = true;
-    }
-    sizes.back() -= 1;
-    checkAndDeleteRedundantDiff(key);
-}
+    /** 
+     * Collapses the diffs of entry in versions [from, to] into one diff at from. Returns 
+     * false if the entry no longer holds any state and can be removed.
+     */
+    bool squashHistory(Entry& entry, unsigned from, unsigned to);
 
-template <typename K, typename V>
-bool VersionedKvStore<K, V>::exists(K key) {
-    return key_value_store[key] && !key_value_store[key]->deleted;
-}
+    /** 
+     * Collapses each version range as squash() does, in one pass over the keys. Ranges 
+     * need not be sorted; overlapping ranges are merged.
+     */
+    void squashRanges(vector<std::pair<unsigned, unsigned>> ranges);
 
-template <typename K, typename V>
-bool VersionedKvStore<K, V>::exists(K key, unsigned version_num) {
-    Diff* diff = traverseToVersion(key, version_num);
-    return diff && !diff->deleted;
-}
+    /** Squashes the groups of versions that have aged into a retention tier. */
+    void enforceRetention();
 
-template <typename K, typename V>
-V VersionedKvStore<K, V>::get(K key) {
-    if (!exists(key)) {
-        return V();
-    }
-    return key_value_store[key]->value;
-}
+    /** Returns the index into sizes of the version slot holding version_num, which must not be dropped. */
+    size_t slotOf(unsigned version_num);
 
-template <typename K, typename V>
-V VersionedKvStore<K, V>::get(K key, unsigned version_num) {
-    if (!exists(key, version_num)) {
-        return V();
-    }
-    Diff* diff = traverseToVersion(key, version_num);
-    return diff->value;
-}
+    /** Returns the first version of slot. */
+    unsigned slotStart(size_t slot);
 
-template <typename K, typename V>
-unsigned VersionedKvStore<K, V>::maxVersion() {
-    return sizes.size() - 1;
-}
+    /** Returns Compaction::slot_starts, or nullptr while each slot holds a single version. */
+    vector<unsigned>* slotStarts();
 
-template <typename K, typename V>
-void VersionedKvStore<K, V>::set(K key, V value) {
-    if (!key_value_store[key]) {
-        // key previously not instantiated
-        Diff* diff = newDiff();
-        diff->value = value;
-        key_value_store[key] = diff;
-        sizes.back() += 1;
-    } else if (key_value_store[key]->version != maxVersion()) {
-        // key exists but not for current version
-        if (key_value_store[key]->deleted) {
-            sizes.back() += 1;
-        }
-        Diff* diff = newDiff();
-        diff->value = value;
-        diff->prev_diff = key_value_store[key];
-        key_value_store[key] = diff;
-    } else {
-        // key exists for current version
-        key_value_store[key]->deleted = false;
-        key_value_store[key]->value = value;
-    }
-    checkAndDeleteRedundantDiff(key);
-}
+    /** releaseVersionsBefore() without the lock or the cap at the most recently saved version. */
+    size_t releaseBefore(unsigned floor);
 
-template <typename K, typename V>
-size_t VersionedKvStore<K, V>::size() {
-    return sizes.back();
-}
+    /** Drops the slots of released versions, releasing the oldest version first if none are. */
+    void dropReleasedSlots();
 
-template <typename K, typename V>
-size_t VersionedKvStore<K, V>::size(unsigned version_num) {
-    if (maxVersion() < version_num) {
-        return size();
-    }
-    return sizes[version_num];
-}
+    /** Frees the diffs and bookkeeping of entry before it is removed from key_value_store. */
+    void releaseEntry(Entry& entry);
 
-template <typename K, typename V>
-unsigned VersionedKvStore<K, V>::save() {
-    unsigned version = maxVersion();
-    sizes.push_back(size());
-    return version;
-}
+    /** Releases and removes the entries of Compaction::removed_keys, then empties it. Returns the number removed. */
+    size_t removeKeys();
 
+    /** Returns true if KeyHandles to entry exist. */
+    static bool hasHandles(const Entry& entry);
 
-/** Private Method Implementations */ 
-template <typename K, typename V>
-typename VersionedKvStore<K, V>::Diff* VersionedKvStore<K, V>::newDiff() {
-    Diff* diff = new Diff();
-    diff->deleted = false;
-    diff->prev_diff = nullptr;
-    diff->version = maxVersion();
-    return diff;
-}
+    /** Remembers that key changed in the current version so it is published on save(). */
+    void recordChange(const K& key, Diff* head);
 
-template <typename K, typename V>
-void VersionedKvStore<K, V>::checkAndDeleteRedundantDiff(K key) {
-    if (key_value_store[key]->prev_diff 
-            && diffsEqual(key_value_store[key], key_value_store[key]->prev_diff)) {
-        Diff* duplicate = key_value_store[key];
-        key_value_store[key] = key_value_store[key]->prev_diff;
-        delete duplicate;
-    }
-}
+    /** Delivers the keys changed in the current version to every feed and the change log. */
+    void publishChanges();
 
-template <typename K, typename V>
-bool VersionedKvStore<K, V>::diffsEqual(Diff* d1, Diff* d2) {
-    return d1->value == d2->value && d1->deleted == d2->deleted;
-}
+    /** Drops change_capture once neither feeds nor the change log need it. */
+    void releaseIdleChangeCapture();
 
-template <typename K, typename V>
-typename VersionedKvStore<K, V>::Diff* VersionedKvStore<K, V>::traverseToVersion(K key, int version_num) {
-    Diff* curr = key_value_store[key];
+    /** Erases every key whose deadline has passed in the version just started by save(). */
+    void expireKeys();
 
-    // traverse to diff having prev_diff not greater than version_num
-    while (curr && curr->prev_diff && version_num < curr->prev_diff->version) {
-        curr = curr->prev_diff;
-    }
+    /** Returns the steady clock time in whole seconds, the tick unit for time based expiry. */
+    static uint64_t currentSecond();
 
-    // get prev_diff if current diff has version_num greater than that requested
-    if (curr && version_num < curr->version) {
-        curr = curr->prev_diff;
-    }
+    /** Returns true if the chain of entry is in the spill file. */
+    static bool isSpilled(const Entry& entry);
+
+    /** Marks entry as recently used and reads its chain back if it was spilled. */
+    void touch(Entry& entry);
+
+    /** Spills chains picked by the CLOCK hand until the memory bound holds. Never spills pinned. */
+    void evictIfOverCapacity(Entry* pinned);
+
+    /** Writes the chain of entry to the spill file and frees its diffs. */
+    void spillChain(Entry& entry);
+
+    /** Reads the chain of entry back from the spill file. */
+    void faultIn(Entry& entry);
+
+    /** Adds entry to the CLOCK ring. */
+    void trackResident(Entry& entry);
+
+    /** Removes entry from the CLOCK ring. */
+    void untrackResident(Entry& entry);
+
+    /** Index from each key to its chain of diffs. */
+    KeyIndexType key_value_store;
+
+    /** Number of key value pairs for each saved version slot of the key value store. */
+    SmallVector<size_t, Policy::kInlineVersions> sizes;
+
+    /** Number of key value pairs in the current version, not yet in sizes. */
+    size_t current_size;
+
+    /** Version being written, see maxVersion(). */
+    unsigned current_version;
+
+    /** Versions before this one have been released, see releaseVersionsBefore(). */
+    unsigned retention_floor;
+
+    /** Number of diffs allocated from diffs. */
+    size_t resident_diffs;
+
+    /** Number of entries with a history index. */
+    size_t indexed_keys;
+
+    /** Change feed and log state. nullptr while unused, so set() and erase() pay one check. */
+    std::unique_ptr<ChangeCapture> change_capture;
+
+    /** Ttl state. nullptr until a key is set with a ttl. */
+    std::unique_ptr<Expiry> expiry;
+
+    /** Spilling state. nullptr unless a memory bound is in force. */
+    std::unique_ptr<Spill> spill;
+
+    /** Retention state. nullptr unless old versions are downsampled. */
+    std::unique_ptr<Retention> retention;
+
+    /** Squash and release state. nullptr until either is first used, unless the policy bounds the store. */
+    std::unique_ptr<Compaction> compaction;
+
+    /** Storage for every diff referenced from key_value_store. */
+    typename Policy::template Allocator<Diff> diffs;
+
+    /** Lock taken by public operations. Not moved or swapped with the contents. */
+    typename Policy::Locking lock;
+};
+
+
+/** Public Method implementations */
+template <typename K, typename V, typename Policy>
+VersionedKvStore<K, V, Policy>::VersionedKvStore() 
+    : current_size(0), current_version(0), retention_floor(0), resident_diffs(0), indexed_keys(0) {
+    if (Policy::kMaxVersions != SIZE_MAX || Policy::kMaxKeys != SIZE_MAX) {
+        compaction.reset(new Compaction());
+    }
+    if (Policy::kMaxVersions != SIZE_MAX) {
+        // the current version is held in current_size
+        sizes.reserve(Policy::kMaxVersions - 1);
+        compaction->slot_starts.reserve(Policy::kMaxVersions);
+    }
+    if (Policy::kMaxKeys != SIZE_MAX) {
+        compaction->removed_keys.reserve(Policy::kMaxKeys);
+    }
+}
+
+template <typename K, typename V, typename Policy>
+VersionedKvStore<K, V, Policy>::VersionedKvStore(VersionedKvStore&& other) noexcept 
+    : VersionedKvStore(other, Guard(other.lock)) {}
+
+template <typename K, typename V, typename Policy>
+VersionedKvStore<K, V, Policy>::~VersionedKvStore() {
+    // an arena frees whole blocks on destruction, so chains then only need
+    // walking when values hold resources of their own
+    typedef typename Policy::template Allocator<Diff> Allocator;
+    if (!Allocator::kReleasesOnDestruction) {
+        key_value_store.forEach([this](const auto&, Entry& entry) {
+            Diff* diff = entry.head;
+            while (diff) {
+                Diff* prev_diff = diff->prev_diff;
+                diffs.destroy(diff);
+                diff = prev_diff;
+            }
+        });
+    } else if (!std::is_trivially_destructible<Diff>::value) {
+        key_value_store.forEach([](const auto&, Entry& entry) {
+            Diff* diff = entry.head;
+            while (diff) {
+                Diff* prev_diff = diff->prev_diff;
+                diff->~Diff();
+                diff = prev_diff;
+            }
+        });
+    }
+}
+
+template <typename K, typename V, typename Policy>
+VersionedKvStore<K, V, Policy>& VersionedKvStore<K, V, Policy>::operator=(VersionedKvStore&& other) noexcept {
+    // previous contents are released when the temporary goes out of scope
+    VersionedKvStore(std::move(other)).swap(*this);
+    return *this;
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::swap(VersionedKvStore& other) noexcept {
+    if (this == &other) {
+        return;
+    }
+    // locks are taken in address order, so two swaps of the same stores cannot deadlock
+    bool this_first = std::less<VersionedKvStore*>()(this, &other);
+    Guard first_guard(this_first ? lock : other.lock);
+    Guard second_guard(this_first ? other.lock : lock);
+    key_value_store.swap(other.key_value_store);
+    sizes.swap(other.sizes);
+    std::swap(current_size, other.current_size);
+    std::swap(current_version, other.current_version);
+    std::swap(retention_floor, other.retention_floor);
+    std::swap(resident_diffs, other.resident_diffs);
+    std::swap(indexed_keys, other.indexed_keys);
+    change_capture.swap(other.change_capture);
+    expiry.swap(other.expiry);
+    spill.swap(other.spill);
+    retention.swap(other.retention);
+    compaction.swap(other.compaction);
+    diffs.swap(other.diffs);
+}
+
+template <typename K, typename V, typename Policy>
+std::thread VersionedKvStore<K, V, Policy>::clearAsync() {
+    Guard guard(lock);
+    // only the data moves to the garbage store; the settings stay with this one
+    std::unique_ptr<VersionedKvStore> garbage(new VersionedKvStore());
+    key_value_store.swap(garbage->key_value_store);
+    sizes.swap(garbage->sizes);
+    std::swap(current_size, garbage->current_size);
+    std::swap(current_version, garbage->current_version);
+    std::swap(retention_floor, garbage->retention_floor);
+    std::swap(resident_diffs, garbage->resident_diffs);
+    std::swap(indexed_keys, garbage->indexed_keys);
+    // slot starts name versions that are gone; a fresh store has none, or reserved ones
+    compaction.swap(garbage->compaction);
+    diffs.swap(garbage->diffs);
+    // deadlines name keys that are gone, and the wheels must restart at version 0
+    expiry.swap(garbage->expiry);
+    if (change_capture) {
+        change_capture->changed_keys.clear();
+        change_capture->cleared = true;
+        if (change_capture->log) {
+            change_capture->log->restart(0);
+        }
+    }
+    if (spill) {
+        spill->file.clear();
+        spill->clock.clear();
+        spill->hand = 0;
+    }
+    if (retention) {
+        retention->squashed_until.assign(retention->tiers.size(), 0);
+    }
+    std::thread teardown([](VersionedKvStore* store) { delete store; }, garbage.get());
+    garbage.release();
+    return teardown;
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::erase(K key) {
+    static_assert(!kBounded, "stores with bounded capacity must write with trySet() and tryErase(), which can refuse");
+    Guard guard(lock);
+    if (expiry) {
+        expiry->deadlines.erase(key);
+    }
+    Entry* entry = findEntry(key);
+    if (entry) {
+        eraseEntry(key, *entry);
+    }
+}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::exists(K key) {
+    Guard guard(lock);
+    // lifetimes answer without touching, or reading back, the chain
+    Entry* entry = key_value_store.find(key);
+    return entry && entry->lifetime.alive();
+}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::exists(K key, unsigned version_num) {
+    Guard guard(lock);
+    Entry* entry = key_value_store.find(key);
+    return entry && entry->lifetime.aliveAt(version_num);
+}
+
+template <typename K, typename V, typename Policy>
+V VersionedKvStore<K, V, Policy>::get(K key) {
+    Guard guard(lock);
+    Entry* entry = findEntry(key);
+    if (!entry || !entry->head || entry->head->deleted) {
+        return V();
+    }
+    return ValuePolicy::full(entry->head->value);
+}
+
+template <typename K, typename V, typename Policy>
+V VersionedKvStore<K, V, Policy>::get(K key, unsigned version_num) {
+    Guard guard(lock);
+    Entry* entry = key_value_store.find(key);
+    return entry ? valueAt(*entry, version_num) : V();
+}
+
+template <typename K, typename V, typename Policy>
+typename VersionedKvStore<K, V, Policy>::KeyHandle VersionedKvStore<K, V, Policy>::handle(K key) {
+    static_assert(!kBounded, "handle() may insert a key, which a store with bounded capacity may have no room for");
+    static_assert(!Policy::kSlimEntries, "slim entries keep no count of their handles");
+    static_assert(!kMovingEntries, "handles point at entries, which the key index may move");
+    Guard guard(lock);
+    Entry& entry = key_value_store[key];
+    return KeyHandle(*this, std::move(key), entry);
+}
+
+template <typename K, typename V, typename Policy>
+V VersionedKvStore<K, V, Policy>::get(const KeyHandle& handle) {
+    Guard guard(lock);
+    Entry& entry = *handle.entry;
+    if (spill) {
+        touch(entry);
+    }
+    if (!entry.head || entry.head->deleted) {
+        return V();
+    }
+    return ValuePolicy::full(entry.head->value);
+}
+
+template <typename K, typename V, typename Policy>
+V VersionedKvStore<K, V, Policy>::get(const KeyHandle& handle, unsigned version_num) {
+    Guard guard(lock);
+    return valueAt(*handle.entry, version_num);
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::set(const KeyHandle& handle, V value) {
+    static_assert(!kBounded, "stores with bounded capacity must write with trySet() and tryErase(), which can refuse");
+    Guard guard(lock);
+    if (spill) {
+        touch(*handle.entry);
+    }
+    setEntry(handle.key, *handle.entry, std::move(value));
+}
+
+template <typename K, typename V, typename Policy>
+vector<typename VersionedKvStore<K, V, Policy>::Interval> 
+VersionedKvStore<K, V, Policy>::aliveIntervals(K key) {
+    Guard guard(lock);
+    vector<Interval> intervals;
+    Entry* entry = key_value_store.find(key);
+    if (!entry) {
+        return intervals;
+    }
+    const BasicLifetime<Policy::kInlineToggles>& lifetime = entry->lifetime;
+    for (size_t i = 0; i < lifetime.toggleCount(); i += 2) {
+        unsigned erased = i + 1 < lifetime.toggleCount() ? lifetime.toggle(i + 1) : kStillAlive;
+        intervals.push_back(Interval{ lifetime.toggle(i), erased });
+    }
+    return intervals;
+}
+
+template <typename K, typename V, typename Policy>
+unsigned VersionedKvStore<K, V, Policy>::maxVersion() {
+    Guard guard(lock);
+    return current_version;
+}
+
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::set(K key, V value) {
+    static_assert(!kBounded, "stores with bounded capacity must write with trySet() and tryErase(), which can refuse");
+    Guard guard(lock);
+    setEntry(key, entryFor(key), std::move(value));
+}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::trySet(K key, V value) {
+    Guard guard(lock);
+    Entry* entry = findEntry(key);
+    if (!hasRoom(entry, true)) {
+        return false;
+    }
+    setEntry(key, entry ? *entry : entryFor(key), std::move(value));
+    return true;
+}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::tryErase(K key) {
+    Guard guard(lock);
+    Entry* entry = findEntry(key);
+    if (!hasRoom(entry, false)) {
+        return false;
+    }
+    if (expiry) {
+        expiry->deadlines.erase(key);
+    }
+    if (entry) {
+        eraseEntry(key, *entry);
+    }
+    return true;
+}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::compareAndSet(K key, const V& expected, V desired) {
+    Guard guard(lock);
+    Entry* entry = findEntry(key);
+    if (!entry || !entry->head || entry->head->deleted || !(ValuePolicy::full(entry->head->value) == expected)) {
+        return false;
+    }
+    if (!hasRoom(entry, true)) {
+        return false;
+    }
+    setEntry(key, *entry, std::move(desired));
+    return true;
+}
+
+template <typename K, typename V, typename Policy>
+template <typename F>
+bool VersionedKvStore<K, V, Policy>::update(K key, F fn) {
+    Guard guard(lock);
+    Entry* entry = findEntry(key);
+    if (!entry || !entry->head || entry->head->deleted || !hasRoom(entry, true)) {
+        return false;
+    }
+    setEntry(key, *entry, fn(ValuePolicy::full(entry->head->value)));
+    return true;
+}
+
+template <typename K, typename V, typename Policy>
+template <typename F>
+V VersionedKvStore<K, V, Policy>::upsert(K key, V initial, F fn) {
+    static_assert(!kBounded, "stores with bounded capacity must write with trySet() and tryErase(), which can refuse");
+    Guard guard(lock);
+    Entry& entry = entryFor(key);
+    V value = entry.head && !entry.head->deleted 
+        ? fn(ValuePolicy::full(entry.head->value)) : std::move(initial);
+    setEntry(key, entry, value);
+    return value;
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::set(K key, V value, unsigned ttl_versions) {
+    Guard guard(lock);
+    set(key, value);
+    if (!expiry) {
+        expiry.reset(new Expiry(currentSecond()));
+    }
+    uint64_t tick = static_cast<uint64_t>(maxVersion()) + (ttl_versions == 0 ? 1 : ttl_versions);
+    expiry->deadlines[key] = Deadline{ false, tick };
+    expiry->by_version.schedule(tick, key);
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::set(K key, V value, std::chrono::seconds ttl) {
+    Guard guard(lock);
+    set(key, value);
+    if (!expiry) {
+        expiry.reset(new Expiry(currentSecond()));
+    }
+    uint64_t tick = currentSecond() + (ttl.count() > 0 ? ttl.count() : 0);
+    expiry->deadlines[key] = Deadline{ true, tick };
+    expiry->by_time.schedule(tick, key);
+}
+
+template <typename K, typename V, typename Policy>
+size_t VersionedKvStore<K, V, Policy>::size() {
+    Guard guard(lock);
+    return current_size;
+}
+
+template <typename K, typename V, typename Policy>
+size_t VersionedKvStore<K, V, Policy>::size(const vector<K>& keys, unsigned version_num) {
+    Guard guard(lock);
+    size_t alive = 0;
+    for (const K& key : keys) {
+        Entry* entry = key_value_store.find(key);
+        if (entry && entry->lifetime.aliveAt(version_num)) {
+            ++alive;
+        }
+    }
+    return alive;
+}
+
+template <typename K, typename V, typename Policy>
+size_t VersionedKvStore<K, V, Policy>::size(unsigned version_num) {
+    Guard guard(lock);
+    if (maxVersion() <= version_num) {
+        return size();
+    }
+    if (version_num < slotStart(0)) {
+        return 0;
+    }
+    return sizes[slotOf(version_num)];
+}
+
+template <typename K, typename V, typename Policy>
+unsigned VersionedKvStore<K, V, Policy>::save() {
+    unsigned version;
+    std::shared_ptr<ChangeSetLog> log;
+    {
+        Guard guard(lock);
+        version = maxVersion();
+        if (change_capture) {
+            publishChanges();
+            log = change_capture->log;
+        }
+        if (Policy::kMaxVersions != SIZE_MAX && sizes.size() + 1 == Policy::kMaxVersions) {
+            dropReleasedSlots();
+        }
+        sizes.push_back(current_size);
+        ++current_version;
+        vector<unsigned>* slot_starts = slotStarts();
+        if (slot_starts) {
+            slot_starts->push_back(current_version);
+        }
+        if (expiry) {
+            expireKeys();
+        }
+        if (retention) {
+            enforceRetention();
+        }
+    }
+    // change log readers may read the store before advancing, so backpressure 
+    // waits outside the lock; appends still happen under it, in version order
+    if (log) {
+        log->waitForRoom();
+    }
+    return version;
+}
+
+template <typename K, typename V, typename Policy>
+std::shared_ptr<typename VersionedKvStore<K, V, Policy>::ChangeFeed> 
+VersionedKvStore<K, V, Policy>::subscribe(size_t capacity, bool include_values) {
+    Guard guard(lock);
+    if (!change_capture) {
+        change_capture.reset(new ChangeCapture());
+    }
+    std::shared_ptr<ChangeFeed> feed = std::make_shared<ChangeFeed>(capacity, include_values);
+    change_capture->feeds.push_back(feed);
+    return feed;
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::unsubscribe(const std::shared_ptr<ChangeFeed>& feed) {
+    Guard guard(lock);
+    if (!change_capture) {
+        return;
+    }
+    vector<std::shared_ptr<ChangeFeed>>& feeds = change_capture->feeds;
+    for (size_t i = 0; i < feeds.size(); ++i) {
+        if (feeds[i] == feed) {
+            feeds.erase(feeds.begin() + i);
+            break;
+        }
+    }
+    releaseIdleChangeCapture();
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::enableChangeLog(size_t capacity, typename ChangeSetLog::Backpressure backpressure) {
+    Guard guard(lock);
+    if (!change_capture) {
+        change_capture.reset(new ChangeCapture());
+    }
+    change_capture->log = std::make_shared<ChangeSetLog>(capacity, backpressure, maxVersion());
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::disableChangeLog() {
+    Guard guard(lock);
+    if (!change_capture) {
+        return;
+    }
+    change_capture->log.reset();
+    releaseIdleChangeCapture();
+}
+
+template <typename K, typename V, typename Policy>
+std::shared_ptr<typename VersionedKvStore<K, V, Policy>::ChangeSetLog::Reader> 
+VersionedKvStore<K, V, Policy>::tailChanges(unsigned from_version) {
+    Guard guard(lock);
+    if (!change_capture || !change_capture->log) {
+        return nullptr;
+    }
+    return change_capture->log->openReader(from_version);
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::enableSpill(size_t max_resident_diffs, const std::string& spill_path) {
+    static_assert(!kBounded, "chains read back need diffs a store with bounded capacity may have no room for");
+    static_assert(!Policy::kSlimEntries, "slim entries hold no spill state");
+    static_assert(!kMovingEntries, "the CLOCK ring points at entries, which the key index may move");
+    Guard guard(lock);
+    if (spill) {
+        disableSpill();
+    }
+    spill.reset(new Spill(max_resident_diffs, spill_path));
+    key_value_store.forEach([this](const auto&, Entry& entry) {
+        if (entry.head) {
+            trackResident(entry);
+        }
+    });
+    evictIfOverCapacity(nullptr);
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::disableSpill() {
+    Guard guard(lock);
+    if (!spill) {
+        return;
+    }
+    key_value_store.forEach([this](const auto&, Entry& entry) {
+        if (isSpilled(entry)) {
+            faultIn(entry);
+        }
+    });
+    spill.reset();
+}
+
+template <typename K, typename V, typename Policy>
+size_t VersionedKvStore<K, V, Policy>::residentDiffs() {
+    Guard guard(lock);
+    return resident_diffs;
+}
+
+template <typename K, typename V, typename Policy>
+typename VersionedKvStore<K, V, Policy>::Stats VersionedKvStore<K, V, Policy>::stats() {
+    Guard guard(lock);
+    Stats stats;
+    stats.keys = key_value_store.size();
+    stats.indexed_keys = indexed_keys;
+    stats.listed_keys = stats.keys - indexed_keys;
+    stats.resident_diffs = resident_diffs;
+    stats.spill_file_bytes = spill ? spill->file.fileSize() : 0;
+    return stats;
+}
+
+template <typename K, typename V, typename Policy>
+typename VersionedKvStore<K, V, Policy>::Transaction VersionedKvStore<K, V, Policy>::beginTransaction() {
+    static_assert(!kBounded, "commit() cannot refuse writes for lack of room, so stores with bounded capacity have no transactions");
+    return Transaction(*this);
+}
+
+template <typename K, typename V, typename Policy>
+size_t VersionedKvStore<K, V, Policy>::releaseVersionsBefore(unsigned version) {
+    Guard guard(lock);
+    // the current version is still being written, so at most the last saved one is released up to
+    unsigned last_saved = maxVersion() > 0 ? maxVersion() - 1 : 0;
+    return releaseBefore(version < last_saved ? version : last_saved);
+}
+
+template <typename K, typename V, typename Policy>
+unsigned VersionedKvStore<K, V, Policy>::oldestRetainedVersion() {
+    Guard guard(lock);
+    return retention_floor;
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::squash(unsigned from, unsigned to) {
+    Guard guard(lock);
+    squashRanges({std::make_pair(from, to)});
+}
+
+template <typename K, typename V, typename Policy>
+unsigned VersionedKvStore<K, V, Policy>::translateVersion(unsigned version_num) {
+    Guard guard(lock);
+    if (version_num >= maxVersion() || version_num < slotStart(0)) {
+        return version_num;
+    }
+    return slotStart(slotOf(version_num) + 1) - 1;
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::setRetention(vector<RetentionTier> tiers) {
+    Guard guard(lock);
+    // a stride of 1 keeps every version anyway
+    tiers.erase(std::remove_if(tiers.begin(), tiers.end(), 
+                               [](const RetentionTier& tier) { return tier.stride <= 1; }), 
+                tiers.end());
+    if (tiers.empty()) {
+        retention.reset();
+        return;
+    }
+    std::sort(tiers.begin(), tiers.end(), 
+              [](const RetentionTier& a, const RetentionTier& b) { return a.age < b.age; });
+    retention.reset(new Retention());
+    retention->tiers = std::move(tiers);
+    retention->squashed_until.assign(retention->tiers.size(), 0);
+    enforceRetention();
+}
+
+
+/** Transaction Method implementations */
+template <typename K, typename V, typename Policy>
+VersionedKvStore<K, V, Policy>::Transaction::Transaction(VersionedKvStore& store) : store(&store) {
+    Guard guard(store.lock);
+    unsigned version = store.maxVersion();
+    has_snapshot = version > 0;
+    snapshot = has_snapshot ? version - 1 : 0;
+}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::Transaction::exists(K key) {
+    auto it = writes.find(key);
+    if (it != writes.end()) {
+        return !it->second.deleted;
+    }
+    reads.insert(key);
+    return has_snapshot && store->exists(key, snapshot);
+}
+
+template <typename K, typename V, typename Policy>
+V VersionedKvStore<K, V, Policy>::Transaction::get(K key) {
+    auto it = writes.find(key);
+    if (it != writes.end()) {
+        return it->second.value;
+    }
+    reads.insert(key);
+    return has_snapshot ? store->get(key, snapshot) : V();
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::Transaction::set(K key, V value) {
+    Write& write = writes[key];
+    write.deleted = false;
+    write.value = std::move(value);
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::Transaction::erase(K key) {
+    Write& write = writes[key];
+    write.deleted = true;
+    write.value = V();
+}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::Transaction::commit() {
+    // held across validation and writes so no other writer slips in between
+    Guard guard(store->lock);
+    bool committed = true;
+    for (const K& key : reads) {
+        if (conflicts(key)) {
+            committed = false;
+            break;
+        }
+    }
+    for (auto it = writes.begin(); committed && it != writes.end(); ++it) {
+        committed = !conflicts(it->first);
+    }
+    if (committed) {
+        for (auto it = writes.begin(); it != writes.end(); ++it) {
+            if (it->second.deleted) {
+                store->erase(it->first);
+            } else {
+                store->set(it->first, std::move(it->second.value));
+            }
+        }
+    }
+    reads.clear();
+    writes.clear();
+    return committed;
+}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::Transaction::conflicts(const K& key) {
+    // squash() may lower the version of the head diff, so the version last written decides
+    Entry* entry = store->key_value_store.find(key);
+    if (!entry) {
+        // releaseVersionsBefore() removes keys absent at its floor, and with them when they 
+        // were last written, so an erase after the snapshot is only ruled out below the floor
+        return store->retention_floor > snapshot;
+    }
+    bool has_diffs = entry->head || isSpilled(*entry);
+    return has_diffs && (!has_snapshot || entry->written > snapshot);
+}
+
+
+/** KeyHandle Method implementations */
+template <typename K, typename V, typename Policy>
+VersionedKvStore<K, V, Policy>::KeyHandle::KeyHandle(VersionedKvStore& store, K key, Entry& entry)
+    : store(&store), key(std::move(key)), entry(&entry) {
+    ++entry.handles;
+}
+
+template <typename K, typename V, typename Policy>
+VersionedKvStore<K, V, Policy>::KeyHandle::KeyHandle(const KeyHandle& other)
+    : store(other.store), key(other.key), entry(other.entry) {
+    Guard guard(store->lock);
+    ++entry->handles;
+}
+
+template <typename K, typename V, typename Policy>
+typename VersionedKvStore<K, V, Policy>::KeyHandle& 
+VersionedKvStore<K, V, Policy>::KeyHandle::operator=(KeyHandle other) {
+    // the previous entry is released when other goes out of scope
+    std::swap(store, other.store);
+    std::swap(key, other.key);
+    std::swap(entry, other.entry);
+    return *this;
+}
+
+template <typename K, typename V, typename Policy>
+VersionedKvStore<K, V, Policy>::KeyHandle::~KeyHandle() {
+    Guard guard(store->lock);
+    --entry->handles;
+}
+
+
+/** ChangeFeed Method implementations */
+template <typename K, typename V, typename Policy>
+VersionedKvStore<K, V, Policy>::ChangeFeed::ChangeFeed(size_t capacity, bool include_values)
+    : pending(capacity), include_values(include_values), dropped_count(0) {}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::ChangeFeed::poll(ChangeSetPtr& change_set) {
+    return pending.tryPop(change_set);
+}
+
+template <typename K, typename V, typename Policy>
+size_t VersionedKvStore<K, V, Policy>::ChangeFeed::dropped() const {
+    return dropped_count.load(std::memory_order_relaxed);
+}
+
+
+/** Private Method Implementations */ 
+template <typename K, typename V, typename Policy>
+VersionedKvStore<K, V, Policy>::VersionedKvStore(VersionedKvStore& other, const Guard&) noexcept
+    : key_value_store(std::move(other.key_value_store)),
+      sizes(std::move(other.sizes)),
+      current_size(other.current_size),
+      current_version(other.current_version),
+      retention_floor(other.retention_floor),
+      resident_diffs(other.resident_diffs),
+      indexed_keys(other.indexed_keys),
+      change_capture(std::move(other.change_capture)),
+      expiry(std::move(other.expiry)),
+      spill(std::move(other.spill)),
+      retention(std::move(other.retention)),
+      compaction(std::move(other.compaction)),
+      diffs(std::move(other.diffs)) {
+    // nothing is allocated, so other is left empty at version 0 by resetting what was not moved
+    other.key_value_store.clear();
+    other.sizes.clear();
+    other.current_size = 0;
+    other.current_version = 0;
+    other.retention_floor = 0;
+    other.resident_diffs = 0;
+    other.indexed_keys = 0;
+}
+
+template <typename K, typename V, typename Policy>
+typename VersionedKvStore<K, V, Policy>::Diff* VersionedKvStore<K, V, Policy>::newDiff() {
+    Diff* diff = diffs.create();
+    diff->prev_diff = nullptr;
+    diff->version = maxVersion();
+    diff->deleted = false;
+    diff->recorded = false;
+    ++resident_diffs;
+    return diff;
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::deleteDiff(Diff* diff) {
+    diffs.destroy(diff);
+    --resident_diffs;
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::setEntry(const K& key, Entry& entry, V value) {
+    if (!entry.head) {
+        // key previously not instantiated
+        Diff* diff = newDiff();
+        ValuePolicy::assign(diff->value, std::move(value));
+        entry.head = diff;
+        pushHistory(entry);
+        current_size += 1;
+        if (spill) {
+            trackResident(entry);
+        }
+    } else if (entry.head->version != maxVersion()) {
+        // key exists but not for current version
+        if (entry.head->deleted) {
+            current_size += 1;
+        }
+        Diff* diff = newDiff();
+        ValuePolicy::assign(diff->value, std::move(value));
+        diff->prev_diff = entry.head;
+        entry.head = diff;
+        pushHistory(entry);
+        sealHistory(diff->prev_diff);
+    } else {
+        // key exists for current version
+        if (entry.head->deleted) {
+            current_size += 1;
+        }
+        entry.head->deleted = false;
+        ValuePolicy::assign(entry.head->value, std::move(value));
+    }
+    entry.written = maxVersion();
+    entry.lifetime.record(maxVersion(), true);
+    checkAndDeleteRedundantDiff(entry);
+    if (change_capture) {
+        recordChange(key, entry.head);
+    }
+    if (expiry) {
+        expiry->deadlines.erase(key);
+    }
+    if (spill) {
+        evictIfOverCapacity(&entry);
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::eraseEntry(const K& key, Entry& entry) {
+    if (!entry.head || entry.head->deleted) {
+        // key previously not instantiated or already erased
+        return;
+    } else if (entry.head->version != maxVersion()) {
+        // key exists but not for current version
+        Diff* diff = newDiff();
+        diff->deleted = true;
+        diff->prev_diff = entry.head;
+        entry.head = diff;
+        pushHistory(entry);
+        sealHistory(diff->prev_diff);
+    } else {
+        // key exists for current version
+        entry.head->deleted = true;
+        ValuePolicy::assign(entry.head->value, V());
+    }
+    current_size -= 1;
+    entry.written = maxVersion();
+    entry.lifetime.record(maxVersion(), false);
+    checkAndDeleteRedundantDiff(entry);
+    if (change_capture) {
+        recordChange(key, entry.head);
+    }
+    if (spill) {
+        evictIfOverCapacity(&entry);
+    }
+}
+
+template <typename K, typename V, typename Policy>
+V VersionedKvStore<K, V, Policy>::valueAt(Entry& entry, unsigned version_num) {
+    if (!entry.lifetime.aliveAt(version_num)) {
+        return V();
+    }
+    if (spill) {
+        touch(entry);
+    }
+    Diff* diff = traverseToVersion(entry, version_num);
+    if (!diff) {
+        // only possible for a version released by releaseVersionsBefore()
+        return V();
+    }
+    return valueOf(entry, diff);
+}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::hasRoom(Entry* entry, bool alive) {
+    if (!entry) {
+        // erasing a key never set changes nothing
+        return !alive || (key_value_store.size() < Policy::kMaxKeys && resident_diffs < Policy::kMaxDiffs);
+    }
+    if (!alive && (!entry->head || entry->head->deleted)) {
+        return true;
+    }
+    if ((!entry->head || entry->head->version != maxVersion()) && resident_diffs >= Policy::kMaxDiffs) {
+        return false;
+    }
+    // a toggle within the current version cancels the last one instead of adding to it
+    const BasicLifetime<Policy::kInlineToggles>& lifetime = entry->lifetime;
+    size_t toggles = lifetime.toggleCount();
+    bool adds_toggle = lifetime.alive() != alive && (toggles == 0 || lifetime.toggle(toggles - 1) != maxVersion());
+    return !adds_toggle || toggles < Policy::kMaxToggles;
+}
+
+template <typename K, typename V, typename Policy>
+typename VersionedKvStore<K, V, Policy>::Entry* VersionedKvStore<K, V, Policy>::findEntry(const K& key) {
+    Entry* entry = key_value_store.find(key);
+    if (entry && spill) {
+        touch(*entry);
+    }
+    return entry;
+}
+
+template <typename K, typename V, typename Policy>
+typename VersionedKvStore<K, V, Policy>::Entry& VersionedKvStore<K, V, Policy>::entryFor(const K& key) {
+    Entry& entry = key_value_store[key];
+    if (spill) {
+        touch(entry);
+    }
+    return entry;
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::checkAndDeleteRedundantDiff(Entry& entry) {
+    if (Policy::kDedup && entry.head->prev_diff && diffsEqual(entry.head, entry.head->prev_diff)) {
+        Diff* duplicate = entry.head;
+        entry.head = entry.head->prev_diff;
+        popHistory(entry);
+        deleteDiff(duplicate);
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::sealHistory(Diff* sealed) {
+    Diff* older = sealed->prev_diff;
+    // deltas are only taken between live values; erased diffs hold nothing worth encoding
+    if (older && !older->deleted && !sealed->deleted && ValuePolicy::isFull(sealed->value)) {
+        ValuePolicy::seal(older->value, older->prev_diff ? &older->prev_diff->value : nullptr, 
+                          ValuePolicy::full(sealed->value));
+    }
+}
+
+template <typename K, typename V, typename Policy>
+V VersionedKvStore<K, V, Policy>::valueOf(Entry& entry, Diff* target) {
+    if (ValuePolicy::isFull(target->value)) {
+        return ValuePolicy::full(target->value);
+    }
+    // rebuild from the closest full value above target, one delta at a time
+    vector<Diff*>* indexed = historyIndex(entry);
+    if (indexed) {
+        vector<Diff*>& history = *indexed;
+        size_t position = std::lower_bound(history.begin(), history.end(), target->version,
+            [](Diff* diff, unsigned version) { return diff->version < version; }) - history.begin();
+        size_t keyframe = position + 1;
+        while (!ValuePolicy::isFull(history[keyframe]->value)) {
+            ++keyframe;
+        }
+        V value = ValuePolicy::full(history[keyframe]->value);
+        for (size_t i = keyframe - 1; i > position; --i) {
+            value = ValuePolicy::decode(history[i]->value, value);
+        }
+        return ValuePolicy::decode(target->value, value);
+    }
+    vector<Diff*> path;
+    for (Diff* diff = entry.head; diff != target; diff = diff->prev_diff) {
+        if (ValuePolicy::isFull(diff->value)) {
+            path.clear();
+        }
+        path.push_back(diff);
+    }
+    V value = ValuePolicy::full(path.front()->value);
+    for (size_t i = 1; i < path.size(); ++i) {
+        value = ValuePolicy::decode(path[i]->value, value);
+    }
+    return ValuePolicy::decode(target->value, value);
+}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::diffsEqual(Diff* d1, Diff* d2) {
+    // erased keys are equivalent whatever value their diff last held
+    return d1->deleted == d2->deleted 
+        && (d1->deleted || ValuePolicy::full(d1->value) == ValuePolicy::full(d2->value));
+}
+
+template <typename K, typename V, typename Policy>
+typename VersionedKvStore<K, V, Policy>::Diff* VersionedKvStore<K, V, Policy>::traverseToVersion(Entry& entry, unsigned version_num) {
+    vector<Diff*>* indexed = historyIndex(entry);
+    if (indexed) {
+        vector<Diff*>& history = *indexed;
+        auto after = std::upper_bound(history.begin(), history.end(), version_num,
+            [](unsigned version, Diff* diff) { return version < diff->version; });
+        return after == history.begin() ? nullptr : *(after - 1);
+    }
+    Diff* curr = entry.head;
+
+    // traverse to diff having prev_diff not greater than version_num
+    while (curr && curr->prev_diff && version_num < curr->prev_diff->version) {
+        curr = curr->prev_diff;
+    }
+
+    // get prev_diff if current diff has version_num greater than that requested
+    if (curr && version_num < curr->version) {
+        curr = curr->prev_diff;
+    }
     return curr;
 }
 
-#endif // __VERSIONED_KV_STORE__
\ No newline at end of file
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::pushHistory(Entry& entry) {
+    // slim entries are neither counted nor indexed, so their chains are always walked
+    if constexpr (!Policy::kSlimEntries) {
+        ++entry.chain_length;
+        if (entry.history) {
+            entry.history->push_back(entry.head);
+        } else if (entry.chain_length >= Policy::kHistoryIndexThreshold) {
+            rebuildHistory(entry);
+        }
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::popHistory(Entry& entry) {
+    if constexpr (!Policy::kSlimEntries) {
+        --entry.chain_length;
+        if (entry.history) {
+            entry.history->pop_back();
+            // hysteresis, so a chain hovering at the threshold is not reindexed on every write
+            if (entry.chain_length < Policy::kHistoryIndexThreshold / 2) {
+                entry.history.reset();
+                --indexed_keys;
+            }
+        }
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::rebuildHistory(Entry& entry) {
+    if constexpr (!Policy::kSlimEntries) {
+        if (entry.history) {
+            entry.history.reset();
+            --indexed_keys;
+        }
+        if (!entry.head) {
+            // spilled; the index is rebuilt when the chain is read back
+            return;
+        }
+        entry.chain_length = 0;
+        for (Diff* diff = entry.head; diff; diff = diff->prev_diff) {
+            ++entry.chain_length;
+        }
+        if (entry.chain_length < Policy::kHistoryIndexThreshold) {
+            return;
+        }
+        entry.history.reset(new vector<Diff*>(entry.chain_length));
+        vector<Diff*>& history = *entry.history;
+        size_t position = entry.chain_length;
+        for (Diff* diff = entry.head; diff; diff = diff->prev_diff) {
+            history[--position] = diff;
+        }
+        ++indexed_keys;
+    }
+}
+
+template <typename K, typename V, typename Policy>
+vector<typename VersionedKvStore<K, V, Policy>::Diff*>* VersionedKvStore<K, V, Policy>::historyIndex(Entry& entry) {
+    if constexpr (Policy::kSlimEntries) {
+        return nullptr;
+    } else {
+        return entry.history.get();
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::pruneHistory(Entry& entry) {
+    Diff* visible = traverseToVersion(entry, retention_floor);
+    if (!visible || (!visible->prev_diff && !visible->deleted)) {
+        return;
+    }
+    Diff* older = visible->prev_diff;
+    visible->prev_diff = nullptr;
+    while (older) {
+        Diff* prev_diff = older->prev_diff;
+        deleteDiff(older);
+        older = prev_diff;
+    }
+    if (visible->deleted && visible != entry.head) {
+        // the tombstone only hid older diffs, and a newer diff now starts the key's history
+        Diff* newer = entry.head;
+        while (newer->prev_diff != visible) {
+            newer = newer->prev_diff;
+        }
+        newer->prev_diff = nullptr;
+        deleteDiff(visible);
+    }
+    rebuildHistory(entry);
+}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::squashHistory(Entry& entry, unsigned from, unsigned to) {
+    entry.lifetime.squash(from, to);
+    Diff* above = nullptr;
+    Diff* top = entry.head;
+    while (top && top->version > to) {
+        above = top;
+        top = top->prev_diff;
+    }
+    if (!top || top->version < from) {
+        return true;
+    }
+    Diff* below = top->prev_diff;
+    while (below && below->version >= from) {
+        below = below->prev_diff;
+    }
+    if (below == top->prev_diff && top->version == from) {
+        return true;
+    }
+
+    // values are decoded before relinking, while every delta still has its base
+    bool below_live = below && !below->deleted;
+    V below_value = below_live ? valueOf(entry, below) : V();
+    bool redundant = below 
+        ? top->deleted == below->deleted && (top->deleted || valueOf(entry, top) == below_value)
+        : top->deleted;
+
+    for (Diff* diff = top->prev_diff; diff != below;) {
+        Diff* prev_diff = diff->prev_diff;
+        deleteDiff(diff);
+        diff = prev_diff;
+    }
+    top->prev_diff = below;
+    top->version = from;
+    if (below_live && !ValuePolicy::isFull(below->value)) {
+        // its base was freed; a full value keeps the diffs below it decodable
+        ValuePolicy::assign(below->value, std::move(below_value));
+    }
+    if (redundant) {
+        if (above) {
+            above->prev_diff = below;
+        } else {
+            entry.head = below;
+        }
+        deleteDiff(top);
+    }
+    if (!entry.head) {
+        // created and erased within the range
+        if (spill) {
+            untrackResident(entry);
+        }
+        return false;
+    }
+    rebuildHistory(entry);
+    return true;
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::squashRanges(vector<std::pair<unsigned, unsigned>> ranges) {
+    if (maxVersion() == 0) {
+        return;
+    }
+    // the current version is still being written
+    unsigned last_saved = maxVersion() - 1;
+    std::sort(ranges.begin(), ranges.end());
+    // versions without a slot were released, so there is nothing left to squash
+    unsigned first_slotted = slotStart(0);
+    vector<std::pair<size_t, size_t>> slot_ranges;
+    for (const std::pair<unsigned, unsigned>& range : ranges) {
+        unsigned to = range.second < last_saved ? range.second : last_saved;
+        unsigned from = range.first > first_slotted ? range.first : first_slotted;
+        if (from >= to) {
+            continue;
+        }
+        size_t first_slot = slotOf(from);
+        size_t last_slot = slotOf(to);
+        if (!slot_ranges.empty() && first_slot <= slot_ranges.back().second) {
+            slot_ranges.back().second = std::max(slot_ranges.back().second, last_slot);
+        } else if (first_slot < last_slot) {
+            slot_ranges.push_back(std::make_pair(first_slot, last_slot));
+        }
+    }
+    if (slot_ranges.empty()) {
+        return;
+    }
+    vector<std::pair<unsigned, unsigned>> version_ranges;
+    for (const std::pair<size_t, size_t>& slots : slot_ranges) {
+        version_ranges.push_back(std::make_pair(slotStart(slots.first), slotStart(slots.second + 1) - 1));
+    }
+
+    if (!compaction) {
+        compaction.reset(new Compaction());
+    }
+    vector<K>& removed_keys = compaction->removed_keys;
+    key_value_store.forEach([this, &version_ranges, &removed_keys](const auto& key, Entry& entry) {
+        bool spilled = isSpilled(entry);
+        if (spilled) {
+            if (entry.written < version_ranges.front().first) {
+                // the chain has no diff in any range, so it stays on disk
+                for (const std::pair<unsigned, unsigned>& range : version_ranges) {
+                    entry.lifetime.squash(range.first, range.second);
+                }
+                return;
+            }
+            faultIn(entry);
+        }
+        for (const std::pair<unsigned, unsigned>& range : version_ranges) {
+            if (!squashHistory(entry, range.first, range.second)) {
+                if (!hasHandles(entry)) {
+                    removed_keys.emplace_back(key);
+                } else {
+                    // handles keep the entry, holding no state like a key never set
+                    releaseEntry(entry);
+                }
+                break;
+            }
+        }
+        if (spilled && entry.head) {
+            // squashing does not make a key recently used
+            spillChain(entry);
+        }
+    });
+    removeKeys();
+
+    vector<unsigned>& slot_starts = compaction->slot_starts;
+    if (slot_starts.empty()) {
+        slot_starts.resize(sizes.size() + 1);
+        for (size_t slot = 0; slot < slot_starts.size(); ++slot) {
+            slot_starts[slot] = first_slotted + slot;
+        }
+    }
+    // newest first, so the slots of earlier ranges keep their positions
+    for (size_t i = slot_ranges.size(); i-- > 0;) {
+        size_t first_slot = slot_ranges[i].first;
+        size_t last_slot = slot_ranges[i].second;
+        sizes[first_slot] = sizes[last_slot];
+        sizes.erase(sizes.begin() + first_slot + 1, sizes.begin() + last_slot + 1);
+        slot_starts.erase(slot_starts.begin() + first_slot + 1, slot_starts.begin() + last_slot + 1);
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::enforceRetention() {
+    unsigned current = maxVersion();
+    vector<std::pair<unsigned, unsigned>> groups;
+    for (size_t i = 0; i < retention->tiers.size(); ++i) {
+        const RetentionTier& tier = retention->tiers[i];
+        if (current <= tier.age) {
+            break;
+        }
+        // versions before current - age have aged into the tier; only whole groups are squashed
+        unsigned aged = (current - tier.age) / tier.stride * tier.stride;
+        unsigned& squashed_until = retention->squashed_until[i];
+        for (; squashed_until < aged; squashed_until += tier.stride) {
+            groups.push_back(std::make_pair(squashed_until, squashed_until + tier.stride - 1));
+        }
+    }
+    if (!groups.empty()) {
+        squashRanges(std::move(groups));
+    }
+}
+
+template <typename K, typename V, typename Policy>
+size_t VersionedKvStore<K, V, Policy>::slotOf(unsigned version_num) {
+    vector<unsigned>* slot_starts = slotStarts();
+    if (!slot_starts) {
+        return version_num - slotStart(0);
+    }
+    return std::upper_bound(slot_starts->begin(), slot_starts->end(), version_num) - slot_starts->begin() - 1;
+}
+
+template <typename K, typename V, typename Policy>
+unsigned VersionedKvStore<K, V, Policy>::slotStart(size_t slot) {
+    // without squashes the slots end at the current version, one version each
+    vector<unsigned>* slot_starts = slotStarts();
+    return slot_starts ? (*slot_starts)[slot] : current_version - (sizes.size() - slot);
+}
+
+template <typename K, typename V, typename Policy>
+vector<unsigned>* VersionedKvStore<K, V, Policy>::slotStarts() {
+    return compaction && !compaction->slot_starts.empty() ? &compaction->slot_starts : nullptr;
+}
+
+template <typename K, typename V, typename Policy>
+size_t VersionedKvStore<K, V, Policy>::releaseBefore(unsigned floor) {
+    if (floor <= retention_floor) {
+        return 0;
+    }
+    retention_floor = floor;
+    if (!compaction) {
+        compaction.reset(new Compaction());
+    }
+
+    vector<K>& removed_keys = compaction->removed_keys;
+    key_value_store.forEach([this, &removed_keys](const auto& key, Entry& entry) {
+        entry.lifetime.releaseBefore(retention_floor);
+        if (entry.lifetime.toggleCount() == 0 && !hasHandles(entry)) {
+            // absent at the floor and never set since
+            removed_keys.emplace_back(key);
+        } else if (entry.head) {
+            pruneHistory(entry);
+        }
+    });
+    return removeKeys();
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::dropReleasedSlots() {
+    size_t dropped = slotOf(retention_floor);
+    if (dropped == 0) {
+        // every version is retained, so the oldest is released to make room
+        releaseBefore(slotStart(1));
+        dropped = slotOf(retention_floor);
+    }
+    // the floor stays in the first slot
+    vector<unsigned>* slot_starts = slotStarts();
+    if (slot_starts) {
+        slot_starts->erase(slot_starts->begin(), slot_starts->begin() + dropped);
+    }
+    sizes.erase(sizes.begin(), sizes.begin() + dropped);
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::releaseEntry(Entry& entry) {
+    if constexpr (!Policy::kSlimEntries) {
+        if (spill && entry.head) {
+            untrackResident(entry);
+        }
+        if (entry.spill_offset != kNotSpilled) {
+            spill->file.release(entry.spill_offset);
+            entry.spill_offset = kNotSpilled;
+        }
+    }
+    Diff* diff = entry.head;
+    while (diff) {
+        Diff* prev_diff = diff->prev_diff;
+        deleteDiff(diff);
+        diff = prev_diff;
+    }
+    entry.head = nullptr;
+    if constexpr (!Policy::kSlimEntries) {
+        entry.chain_length = 0;
+        if (entry.history) {
+            entry.history.reset();
+            --indexed_keys;
+        }
+    }
+}
+
+template <typename K, typename V, typename Policy>
+size_t VersionedKvStore<K, V, Policy>::removeKeys() {
+    vector<K>& removed_keys = compaction->removed_keys;
+    for (const K& key : removed_keys) {
+        releaseEntry(*key_value_store.find(key));
+        key_value_store.erase(key);
+    }
+    size_t removed = removed_keys.size();
+    removed_keys.clear();
+    return removed;
+}
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::hasHandles(const Entry& entry) {
+    if constexpr (Policy::kSlimEntries) {
+        return false;
+    } else {
+        return entry.handles > 0;
+    }
+}
+
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::recordChange(const K& key, Diff* head) {
+    // a key only needs recording once per diff; reverted changes leave an older head
+    if (head->version == maxVersion() && !head->recorded) {
+        head->recorded = true;
+        change_capture->changed_keys.push_back(key);
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::publishChanges() {
+    unsigned version = maxVersion();
+    std::shared_ptr<ChangeSet> keys_only = std::make_shared<ChangeSet>();
+    std::shared_ptr<ChangeSet> with_values = std::make_shared<ChangeSet>();
+    keys_only->version = version;
+    with_values->version = version;
+    keys_only->cleared = change_capture->cleared;
+    with_values->cleared = change_capture->cleared;
+    change_capture->cleared = false;
+
+    bool values_wanted = static_cast<bool>(change_capture->log);
+    for (const std::shared_ptr<ChangeFeed>& feed : change_capture->feeds) {
+        values_wanted = values_wanted || feed->include_values;
+    }
+
+    for (const K& key : change_capture->changed_keys) {
+        Entry* entry = findEntry(key);
+        Diff* diff = entry ? entry->head : nullptr;
+        if (!diff || diff->version != version || !diff->recorded) {
+            // reverted since it was recorded, or a duplicate entry
+            continue;
+        }
+        diff->recorded = false;
+        if (diff->deleted && !diff->prev_diff) {
+            // created and erased within this version
+            continue;
+        }
+        Change change = { key, diff->deleted, V() };
+        keys_only->changes.push_back(change);
+        if (values_wanted) {
+            change.value = ValuePolicy::full(diff->value);
+            with_values->changes.push_back(change);
+        }
+    }
+    change_capture->changed_keys.clear();
+
+    for (const std::shared_ptr<ChangeFeed>& feed : change_capture->feeds) {
+        ChangeSetPtr change_set = feed->include_values ? with_values : keys_only;
+        if (!feed->pending.tryPush(std::move(change_set))) {
+            feed->dropped_count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (change_capture->log) {
+        change_capture->log->append(with_values);
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::releaseIdleChangeCapture() {
+    if (!change_capture->feeds.empty() || change_capture->log) {
+        return;
+    }
+    // clear marks so a later subscription records these keys again
+    for (const K& key : change_capture->changed_keys) {
+        Entry* entry = findEntry(key);
+        if (entry && entry->head) {
+            entry->head->recorded = false;
+        }
+    }
+    change_capture.reset();
+}
+
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::expireKeys() {
+    vector<K> expired;
+    uint64_t version = maxVersion();
+    uint64_t second = currentSecond();
+    auto collect = [this, &expired, version, second](const K& key) {
+        // keys re-set or erased since being scheduled no longer match their deadline
+        auto it = expiry->deadlines.find(key);
+        if (it != expiry->deadlines.end() 
+                && it->second.tick <= (it->second.by_time ? second : version)) {
+            expired.push_back(key);
+        }
+    };
+    expiry->by_version.advance(version, collect);
+    expiry->by_time.advance(second, collect);
+    for (const K& key : expired) {
+        expiry->deadlines.erase(key);
+        Entry* entry = findEntry(key);
+        if (entry) {
+            eraseEntry(key, *entry);
+        }
+    }
+}
+
+template <typename K, typename V, typename Policy>
+uint64_t VersionedKvStore<K, V, Policy>::currentSecond() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+template <typename K, typename V, typename Policy>
+bool VersionedKvStore<K, V, Policy>::isSpilled(const Entry& entry) {
+    if constexpr (Policy::kSlimEntries) {
+        return false;
+    } else {
+        return entry.spill_offset != kNotSpilled;
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::touch(Entry& entry) {
+    // only reached while spilling, which slim entries cannot
+    if constexpr (!Policy::kSlimEntries) {
+        entry.referenced = true;
+        if (isSpilled(entry)) {
+            faultIn(entry);
+            evictIfOverCapacity(&entry);
+        }
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::evictIfOverCapacity(Entry* pinned) {
+    if constexpr (!Policy::kSlimEntries) {
+        vector<Entry*>& clock = spill->clock;
+        size_t skipped = 0;
+        while (resident_diffs > spill->max_resident_diffs && !clock.empty()) {
+            if (spill->hand >= clock.size()) {
+                spill->hand = 0;
+            }
+            Entry* candidate = clock[spill->hand];
+            if (candidate == pinned || candidate->referenced) {
+                // second chance; two full sweeps without a victim means only pinned is left
+                candidate->referenced = false;
+                ++spill->hand;
+                if (++skipped > 2 * clock.size()) {
+                    break;
+                }
+                continue;
+            }
+            // untracking moves another entry into the hand's slot
+            spillChain(*candidate);
+            skipped = 0;
+        }
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::spillChain(Entry& entry) {
+    if constexpr (!Policy::kSlimEntries) {
+        std::string record;
+        vector<Diff*> chain;
+        for (Diff* diff = entry.head; diff; diff = diff->prev_diff) {
+            chain.push_back(diff);
+        }
+        Serializer<uint32_t>::write(record, chain.size());
+        for (Diff* diff : chain) {
+            Serializer<uint32_t>::write(record, diff->version);
+            Serializer<uint8_t>::write(record, (diff->deleted ? 1 : 0) | (diff->recorded ? 2 : 0));
+            Serializer<typename ValuePolicy::Stored>::write(record, diff->value);
+        }
+        entry.spill_offset = spill->file.append(record);
+        for (Diff* diff : chain) {
+            deleteDiff(diff);
+        }
+        entry.head = nullptr;
+        rebuildHistory(entry);
+        untrackResident(entry);
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::faultIn(Entry& entry) {
+    if constexpr (!Policy::kSlimEntries) {
+        std::string record = spill->file.read(entry.spill_offset);
+        spill->file.release(entry.spill_offset);
+        const char* in = record.data();
+        uint32_t length = Serializer<uint32_t>::read(in);
+        Diff* newest = nullptr;
+        Diff* newer = nullptr;
+        for (uint32_t i = 0; i < length; ++i) {
+            Diff* diff = newDiff();
+            diff->version = Serializer<uint32_t>::read(in);
+            uint8_t flags = Serializer<uint8_t>::read(in);
+            diff->deleted = flags & 1;
+            diff->recorded = flags & 2;
+            diff->value = Serializer<typename ValuePolicy::Stored>::read(in);
+            if (newer) {
+                newer->prev_diff = diff;
+            } else {
+                newest = diff;
+            }
+            newer = diff;
+        }
+        entry.head = newest;
+        entry.spill_offset = kNotSpilled;
+        rebuildHistory(entry);
+        if (retention_floor > 0) {
+            // releaseVersionsBefore() leaves spilled chains alone, so they are pruned once read back
+            pruneHistory(entry);
+        }
+        trackResident(entry);
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::trackResident(Entry& entry) {
+    if constexpr (!Policy::kSlimEntries) {
+        entry.clock_slot = spill->clock.size();
+        spill->clock.push_back(&entry);
+    }
+}
+
+template <typename K, typename V, typename Policy>
+void VersionedKvStore<K, V, Policy>::untrackResident(Entry& entry) {
+    if constexpr (!Policy::kSlimEntries) {
+        vector<Entry*>& clock = spill->clock;
+        Entry* last = clock.back();
+        clock[entry.clock_slot] = last;
+        last->clock_slot = entry.clock_slot;
+        clock.pop_back();
+    }
+}
+
+
+/** Non-member swap so stores work with std::swap idioms. */
+template <typename K, typename V, typename Policy>
+void swap(VersionedKvStore<K, V, Policy>& lhs, VersionedKvStore<K, V, Policy>& rhs) noexcept {
+    lhs.swap(rhs);
+}
+
+#endif // __VERSIONED_KV_STORE__
@@ -1,10 +1,30 @@
+#include "RadixTree.h"
 #include "VersionedKvStore.h"
 
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 
 using namespace std;
 
+struct DeltaPolicy : DefaultPolicy {
+    template <typename V> using Values = DeltaStrings<>;
+};
+
+struct RadixPolicy : DefaultPolicy {
+    template <typename K, typename T> using KeyIndex = RadixTree<K, T>;
+};
+
+struct FastHashPolicy : DefaultPolicy {
+    template <typename K, typename T> using KeyIndex = HashIndex<K, T, FastHash>;
+};
+
+struct ConfigFields {
+    static constexpr string_view kKeys[] = {"timeout_ms", "retries", "endpoint", "log_level", "batch_size"};
+};
+
 
 void testGetSetBasic() {
     VersionedKvStore<string, string> kvstore; 
@@ -77,6 +97,561 @@ void testValuePersistsBasic() {
     }
 }
 
+VersionedKvStore<string, string> buildStore(const string& value) {
+    VersionedKvStore<string, string> kvstore;
+    kvstore.set("hello", value);
+    kvstore.save();
+    kvstore.set("hello", value + "!");
+    return kvstore;
+}
+
+void testMoveBasic() {
+    VersionedKvStore<string, string> kvstore = buildStore("world");
+    cout << kvstore.get("hello") << ' ' << kvstore.get("hello", 0) << endl;
+
+    VersionedKvStore<string, string> replacement = buildStore("there");
+    swap(kvstore, replacement);
+    cout << kvstore.get("hello") << ' ' << replacement.get("hello") << endl;
+
+    kvstore = std::move(replacement);
+    cout << kvstore.get("hello") << ' ' << kvstore.maxVersion() << ' ';
+
+    VersionedKvStore<string, string> moved(std::move(kvstore));
+    kvstore.set("hello", "again");
+    cout << moved.get("hello") << ' ' << kvstore.get("hello") << ' ' << kvstore.maxVersion() << ' ' 
+         << kvstore.size() << endl;
+}
+
+void testClearAsync() {
+    VersionedKvStore<string, string> kvstore;
+    for (int i = 0; i < 1000; ++i) {
+        kvstore.set(to_string(i), "value");
+        kvstore.save();
+    }
+    thread teardown = kvstore.clearAsync();
+    kvstore.set("hello", "world");
+    cout << kvstore.get("hello") << ' ' << kvstore.size() << ' ' << kvstore.maxVersion() << endl;
+    teardown.join();
+}
+
+void testClearAsyncSettings() {
+    typedef VersionedKvStore<string, string> Store;
+    Store kvstore;
+    auto feed = kvstore.subscribe();
+    kvstore.enableChangeLog(4, Store::ChangeSetLog::kDropOldest);
+    auto reader = kvstore.tailChanges(0);
+    kvstore.set("hello", "world");
+    kvstore.save();
+    kvstore.clearAsync().join();
+    kvstore.set("again", "world");
+    kvstore.save();
+
+    Store::ChangeSetPtr change_set;
+    feed->poll(change_set);
+    cout << change_set->version << ' ' << change_set->cleared << ' ';
+    feed->poll(change_set);
+    cout << change_set->version << ' ' << change_set->cleared << ' ' << change_set->changes[0].key << ' ';
+    cout << (reader->next(change_set) == Store::ChangeSetLog::kResync) << ' ';
+    reader->resync(kvstore.maxVersion() - 1);
+    kvstore.set("hello", "there");
+    kvstore.save();
+    cout << (reader->next(change_set) == Store::ChangeSetLog::kRead) << ' ' << change_set->version << endl;
+}
+
+void testChangeFeedBasic() {
+    VersionedKvStore<string, string> kvstore;
+    auto keys = kvstore.subscribe();
+    auto values = kvstore.subscribe(2, true);
+    kvstore.set("hello", "world");
+    kvstore.set("foo", "bar");
+    kvstore.save();
+    kvstore.erase("foo");
+    kvstore.set("hello", "there");
+    kvstore.set("hello", "world");
+    kvstore.save();
+
+    VersionedKvStore<string, string>::ChangeSetPtr change_set;
+    while (keys->poll(change_set)) {
+        cout << change_set->version << ':';
+        for (auto& change : change_set->changes) {
+            cout << ' ' << change.key << (change.deleted ? "-" : "+");
+        }
+        cout << endl;
+    }
+    while (values->poll(change_set)) {
+        cout << change_set->version << ':';
+        for (auto& change : change_set->changes) {
+            cout << ' ' << change.key << '=' << change.value;
+        }
+        cout << endl;
+    }
+    kvstore.unsubscribe(keys);
+    kvstore.unsubscribe(values);
+}
+
+void testChangeLogTail() {
+    typedef VersionedKvStore<string, string> Store;
+    Store kvstore;
+    kvstore.enableChangeLog(2, Store::ChangeSetLog::kDropOldest);
+    auto reader = kvstore.tailChanges(0);
+    for (int i = 0; i < 3; ++i) {
+        kvstore.set("hello", to_string(i));
+        kvstore.save();
+    }
+
+    Store::ChangeSetPtr change_set;
+    if (reader->next(change_set) == Store::ChangeSetLog::kResync) {
+        cout << "resync from " << kvstore.get("hello", 1) << endl;
+        reader->resync(1);
+    }
+    while (reader->next(change_set) == Store::ChangeSetLog::kRead) {
+        cout << change_set->version << ": hello=" << change_set->changes[0].value << endl;
+    }
+    kvstore.disableChangeLog();
+}
+
+void testChangeLogBlocking() {
+    typedef VersionedKvStore<string, string, ThreadSafe> Store;
+    Store kvstore;
+    kvstore.enableChangeLog(1, Store::ChangeSetLog::kBlockWriters);
+    auto reader = kvstore.tailChanges(0);
+    thread writer([&kvstore]() {
+        for (int i = 0; i < 3; ++i) {
+            kvstore.set("hello", to_string(i));
+            kvstore.save();
+        }
+    });
+
+    // the reader reads the store before advancing while saves wait for it
+    Store::ChangeSetPtr change_set;
+    string value;
+    for (int read = 0; read < 3;) {
+        value = kvstore.get("hello");
+        if (reader->waitNext(change_set, chrono::milliseconds(10)) == Store::ChangeSetLog::kRead) {
+            ++read;
+        }
+    }
+    writer.join();
+    cout << change_set->version << ' ' << change_set->changes[0].value << ' ' << kvstore.maxVersion() << endl;
+}
+
+void testTtlVersions() {
+    VersionedKvStore<string, string> kvstore;
+    kvstore.set("session", "abc", 2);
+    kvstore.set("hello", "world");
+    unsigned v1 = kvstore.save();
+    kvstore.save();
+    unsigned v3 = kvstore.save();
+    for (unsigned v = v1; v <= v3 + 1; ++v) {
+        cout << kvstore.exists("session", v) << ':' << kvstore.size(v) << ' ';
+    }
+    cout << endl;
+}
+
+void testSpillBasic() {
+    VersionedKvStore<string, string> kvstore;
+    kvstore.enableSpill(4, "VersionedKvStoreTest.spill");
+    for (int i = 0; i < 8; ++i) {
+        kvstore.set(to_string(i), "v" + to_string(i));
+    }
+    unsigned version1 = kvstore.save();
+    kvstore.set("0", "changed");
+    cout << kvstore.residentDiffs() << ' ';
+    for (int i = 0; i < 8; ++i) {
+        cout << kvstore.get(to_string(i), version1) << ' ';
+    }
+    cout << kvstore.get("0") << ' ' << kvstore.residentDiffs() << endl;
+    kvstore.disableSpill();
+    cout << kvstore.residentDiffs() << endl;
+}
+
+void testSpillChurn() {
+    VersionedKvStore<string, string> kvstore;
+    kvstore.enableSpill(4, "VersionedKvStoreTest.spill");
+    uint64_t early_bytes = 0;
+    for (int i = 0; i < 2000; ++i) {
+        kvstore.set(to_string(i % 16), "value" + to_string(i));
+        unsigned version = kvstore.save();
+        if (i % 10 == 0) {
+            kvstore.releaseVersionsBefore(version);
+        }
+        if (i == 199) {
+            early_bytes = kvstore.stats().spill_file_bytes;
+        }
+    }
+    // chains read back free their records, so churn reuses the file's space
+    uint64_t late_bytes = kvstore.stats().spill_file_bytes;
+    size_t resident = kvstore.residentDiffs();
+    kvstore.squash(kvstore.oldestRetainedVersion(), kvstore.maxVersion() - 1);
+    cout << (late_bytes < 2 * early_bytes) << ' ' << resident << ' ' << kvstore.residentDiffs() << ' ' 
+         << kvstore.get("3") << endl;
+}
+
+void testReadModifyWrite() {
+    VersionedKvStore<string, int> kvstore;
+    cout << kvstore.compareAndSet("counter", 0, 1) << ' ';
+    cout << kvstore.upsert("counter", 1, [](int count) { return count + 1; }) << ' ';
+    cout << kvstore.upsert("counter", 1, [](int count) { return count + 1; }) << ' ';
+    unsigned version1 = kvstore.save();
+    cout << kvstore.compareAndSet("counter", 1, 5) << ' ';
+    cout << kvstore.compareAndSet("counter", 2, 5) << ' ';
+    cout << kvstore.update("counter", [](int count) { return count * 2; }) << ' ';
+    cout << kvstore.update("missing", [](int count) { return count * 2; }) << ' ';
+    cout << kvstore.get("counter") << ' ' << kvstore.get("counter", version1) << endl;
+}
+
+void testTransactionConflict() {
+    VersionedKvStore<string, int> kvstore;
+    kvstore.set("balance", 100);
+    kvstore.save();
+
+    auto withdraw = kvstore.beginTransaction();
+    auto deposit = kvstore.beginTransaction();
+    withdraw.set("balance", withdraw.get("balance") - 30);
+    deposit.set("balance", deposit.get("balance") + 50);
+    cout << withdraw.commit() << ' ' << deposit.commit() << ' ' << kvstore.get("balance") << endl;
+
+    kvstore.save();
+    auto retry = kvstore.beginTransaction();
+    retry.set("balance", retry.get("balance") + 50);
+    cout << retry.commit() << ' ' << kvstore.get("balance") << endl;
+}
+
+void testTransactionSquash() {
+    VersionedKvStore<string, int> kvstore;
+    kvstore.set("balance", 1);
+    kvstore.save();
+    kvstore.save();
+
+    // squashing the newer write into an older version must still fail the commit
+    auto increment = kvstore.beginTransaction();
+    int balance = increment.get("balance");
+    kvstore.set("balance", 100);
+    kvstore.save();
+    kvstore.squash(0, 2);
+    increment.set("balance", balance + 1);
+    cout << increment.commit() << ' ' << kvstore.get("balance") << endl;
+}
+
+void testDeltaValues() {
+    VersionedKvStore<string, string, DeltaPolicy> kvstore;
+    string document(1000, '.');
+    for (unsigned version = 0; version < 5; ++version) {
+        document[version * 100] = '0' + version;
+        kvstore.set("document", document);
+        kvstore.save();
+    }
+    for (unsigned version = 0; version < 5; ++version) {
+        string snapshot = kvstore.get("document", version);
+        for (unsigned i = 0; i < 5; ++i) {
+            cout << snapshot[i * 100];
+        }
+        cout << ' ';
+    }
+    cout << kvstore.get("document").size() << endl;
+}
+
+void testRadixKeys() {
+    VersionedKvStore<string, int, RadixPolicy> kvstore;
+    kvstore.set("/users/alice/name", 1);
+    kvstore.set("/users/alice/mail", 2);
+    kvstore.set("/users/bob/name", 3);
+    kvstore.save();
+    kvstore.erase("/users/alice/mail");
+    kvstore.set("/users", 4);
+    cout << kvstore.get("/users/alice/name") << kvstore.exists("/users/alice/mail") 
+         << kvstore.get("/users/alice/mail", 0) << kvstore.get("/users/bob/name") 
+         << kvstore.get("/users") << kvstore.exists("/users/") << kvstore.size() << endl;
+}
+
+void testArtKeys() {
+    VersionedKvStore<int, int, LowMemory> kvstore;
+    for (int i = -500; i < 500; ++i) {
+        kvstore.set(i, i * 2);
+    }
+    kvstore.save();
+    for (int i = -500; i < 500; i += 2) {
+        kvstore.erase(i);
+    }
+    cout << kvstore.get(-499) << " " << kvstore.exists(-500) << " " << kvstore.get(-500, 0) << " " 
+         << kvstore.size() << " " << kvstore.size(0) << endl;
+}
+
+void testLifetimeExists() {
+    VersionedKvStore<string, int> kvstore;
+    for (unsigned version = 0; version < 6; ++version) {
+        if (version % 3 == 0) {
+            kvstore.set("session", version);
+        } else {
+            kvstore.erase("session");
+        }
+        kvstore.save();
+    }
+    kvstore.enableSpill(0, "VersionedKvStoreTest.spill");
+    for (unsigned version = 0; version < 6; ++version) {
+        cout << kvstore.exists("session", version);
+    }
+    cout << " " << kvstore.residentDiffs() << endl;
+}
+
+void testAliveIntervals() {
+    VersionedKvStore<string, int> kvstore;
+    kvstore.set("a", 1);
+    kvstore.set("b", 1);
+    kvstore.save();
+    kvstore.erase("a");
+    kvstore.save();
+    kvstore.set("a", 2);
+    kvstore.erase("b");
+    kvstore.save();
+    for (auto interval : kvstore.aliveIntervals("a")) {
+        cout << "[" << interval.created << "," << (interval.erased == kvstore.kStillAlive ? -1 : (int)interval.erased) << ") ";
+    }
+    vector<string> keys = { "a", "b", "c" };
+    cout << kvstore.size(keys, 0) << kvstore.size(keys, 1) << kvstore.size(keys, 2) << endl;
+}
+
+void testPolicyPresets() {
+    VersionedKvStore<string, int, ReadOptimized> deduplicated;
+    VersionedKvStore<string, int, WriteOptimized> appended;
+    for (unsigned version = 0; version < 3; ++version) {
+        deduplicated.set("constant", 1);
+        appended.set("constant", 1);
+        deduplicated.save();
+        appended.save();
+    }
+    cout << deduplicated.residentDiffs() << appended.residentDiffs() << " ";
+
+    VersionedKvStore<int, int, ThreadSafe> shared;
+    vector<thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&shared, t]() {
+            for (int i = 0; i < 1000; ++i) {
+                shared.upsert(i % 10, 1, [](int count) { return count + 1; });
+                if (t == 0 && i % 100 == 0) {
+                    shared.save();
+                }
+            }
+        });
+    }
+    for (thread& writer : writers) {
+        writer.join();
+    }
+    int total = 0;
+    for (int key = 0; key < 10; ++key) {
+        total += shared.get(key);
+    }
+    cout << total << endl;
+}
+
+void testHistoryIndex() {
+    VersionedKvStore<string, int, ReadOptimized> kvstore;
+    kvstore.set("cold", 0);
+    for (int version = 0; version < 100; ++version) {
+        kvstore.set("hot", version);
+        kvstore.save();
+    }
+    auto stats = kvstore.stats();
+    cout << stats.keys << " " << stats.listed_keys << " " << stats.indexed_keys << " " 
+         << stats.resident_diffs << " " << kvstore.get("hot", 42) << " " << kvstore.get("cold", 42) << endl;
+}
+
+void testReclaimDeadKeys() {
+    VersionedKvStore<string, int> kvstore;
+    for (int version = 0; version < 100; ++version) {
+        kvstore.set("session" + to_string(version), version);
+        if (version > 0) {
+            kvstore.erase("session" + to_string(version - 1));
+        }
+        kvstore.set("counter", version);
+        kvstore.save();
+    }
+    size_t keys_before = kvstore.stats().keys;
+    size_t diffs_before = kvstore.residentDiffs();
+    size_t reclaimed = kvstore.releaseVersionsBefore(kvstore.maxVersion());
+    cout << keys_before << " " << diffs_before << " " << reclaimed << " " << kvstore.stats().keys << " " 
+         << kvstore.residentDiffs() << " " << kvstore.get("session99") << " " << kvstore.get("counter", 99) << endl;
+}
+
+void testReclaimTransaction() {
+    VersionedKvStore<string, int> kvstore;
+    kvstore.set("a", 1);
+    kvstore.set("b", 2);
+    kvstore.save();
+
+    // the erase of a read key must fail the commit even once its entry was reclaimed
+    auto transfer = kvstore.beginTransaction();
+    int a = transfer.get("a");
+    kvstore.erase("a");
+    kvstore.save();
+    kvstore.releaseVersionsBefore(kvstore.maxVersion());
+    transfer.set("b", a + 2);
+    cout << transfer.commit() << ' ' << kvstore.get("b") << ' ' << kvstore.exists("a") << endl;
+}
+
+void testSquash() {
+    VersionedKvStore<string, int> kvstore;
+    for (int version = 0; version < 10; ++version) {
+        kvstore.set("tick", version);
+        if (version == 3) {
+            kvstore.set("temporary", version);
+        } else if (version == 5) {
+            kvstore.erase("temporary");
+        }
+        kvstore.save();
+    }
+    kvstore.squash(2, 7);
+    cout << kvstore.translateVersion(1) << kvstore.translateVersion(4) << kvstore.translateVersion(8) << " "
+         << kvstore.get("tick", 1) << kvstore.get("tick", 4) << kvstore.get("tick", 7) << kvstore.get("tick", 8) << " "
+         << kvstore.exists("temporary", 3) << kvstore.size(4) << " " << kvstore.residentDiffs() << " " 
+         << kvstore.stats().keys << endl;
+}
+
+void testRetentionTiers() {
+    VersionedKvStore<string, int> kvstore;
+    kvstore.setRetention({{10, 2}, {20, 10}});
+    for (int version = 0; version < 40; ++version) {
+        kvstore.set("tick", version);
+        kvstore.save();
+    }
+    cout << kvstore.translateVersion(3) << " " << kvstore.translateVersion(13) << " " 
+         << kvstore.translateVersion(25) << " " << kvstore.translateVersion(35) << " " 
+         << kvstore.get("tick", 3) << " " << kvstore.residentDiffs() << endl;
+}
+
+void testRetentionTransaction() {
+    VersionedKvStore<string, int> kvstore;
+    kvstore.setRetention({{1, 2}});
+    kvstore.set("balance", 1);
+    kvstore.save();
+
+    // save() squashes the write made while the transaction was open into version 0
+    auto increment = kvstore.beginTransaction();
+    int balance = increment.get("balance");
+    kvstore.set("balance", 100);
+    kvstore.save();
+    kvstore.save();
+    increment.set("balance", balance + 1);
+    cout << kvstore.translateVersion(0) << ' ' << increment.commit() << ' ' << kvstore.get("balance") << endl;
+}
+
+void testKeyHandles() {
+    VersionedKvStore<string, int> kvstore;
+    VersionedKvStore<string, int>::KeyHandle counter = kvstore.handle("counter");
+    VersionedKvStore<string, int>::KeyHandle scratch = kvstore.handle("scratch");
+    kvstore.set(scratch, 7);
+    kvstore.erase("scratch");
+    for (int i = 0; i < 1000; ++i) {
+        kvstore.set(counter, kvstore.get(counter) + 1);
+        kvstore.set("filler" + to_string(i), i);
+        kvstore.save();
+    }
+    kvstore.releaseVersionsBefore(990);
+    kvstore.set(scratch, 8);
+    cout << kvstore.get(counter) << " " << kvstore.get(counter, 994) << " " << kvstore.get("counter") << " " 
+         << kvstore.get("scratch") << " " << kvstore.size() << endl;
+}
+
+void testSwissKeys() {
+    VersionedKvStore<int, int, ReadOptimized> kvstore;
+    for (int key = 0; key < 5000; ++key) {
+        kvstore.set(key, key * 2);
+    }
+    kvstore.save();
+    for (int key = 0; key < 5000; key += 2) {
+        kvstore.erase(key);
+    }
+    kvstore.set(5000, 1);
+    cout << kvstore.get(4999) << " " << kvstore.get(4998) << " " << kvstore.get(4998, 0) << " " 
+         << kvstore.size() << " " << kvstore.size(0) << endl;
+}
+
+void testFastHash() {
+    VersionedKvStore<string, int, FastHashPolicy> kvstore;
+    string long_key(300, 'x');
+    kvstore.set(long_key, 1);
+    kvstore.set(long_key + "y", 2);
+    kvstore.set("", 3);
+    kvstore.save();
+    kvstore.erase(long_key);
+    cout << kvstore.get(long_key, 0) << kvstore.get(long_key + "y") << kvstore.get("") << " " 
+         << kvstore.exists(long_key) << " " 
+         << (FastHash::hashBytes(long_key.data(), 300, 0) != FastHash::hashBytes(long_key.data(), 299, 0)) << endl;
+}
+
+void testDenseKeys() {
+    VersionedKvStore<unsigned, string, DenseKeys> kvstore;
+    for (unsigned id = 0; id < 1000; ++id) {
+        kvstore.set(id, "entity" + to_string(id));
+    }
+    kvstore.save();
+    for (unsigned id = 0; id < 1000; id += 3) {
+        kvstore.erase(id);
+    }
+    kvstore.set(100000, "far");
+    cout << kvstore.get(998) << " " << kvstore.get(999, 0) << " " << kvstore.get(3, 0) << kvstore.get(3) << " " 
+         << kvstore.get(100000) << " " << kvstore.size() << " " << kvstore.size(0) << endl;
+}
+
+void testSmallStore() {
+    VersionedKvStore<string, int, SmallStore> kvstore;
+    for (int key = 0; key < 20; ++key) {
+        kvstore.set("key" + to_string(key), key);
+        if (key == 7) {
+            kvstore.save();
+        }
+    }
+    kvstore.set("key0", 100);
+    kvstore.erase("key19");
+    cout << kvstore.get("key0") << " " << kvstore.get("key0", 0) << " " << kvstore.get("key15") << " " 
+         << kvstore.size(0) << " " << kvstore.size() << endl;
+}
+
+void testFixedCapacity() {
+    VersionedKvStore<int, int, FixedCapacity<4, 8, 64>> kvstore;
+    int accepted = 0;
+    for (int key = 0; key < 6; ++key) {
+        accepted += kvstore.trySet(key, key);
+    }
+    kvstore.save();
+    for (int version = 0; version < 6; ++version) {
+        accepted += kvstore.trySet(0, 100 + version);
+        kvstore.save();
+    }
+    bool erased = kvstore.tryErase(1);
+    bool replaced = kvstore.compareAndSet(2, 2, 20) || kvstore.update(3, [](int value) { return value + 1; });
+    kvstore.releaseVersionsBefore(kvstore.maxVersion() - 1);
+    cout << accepted << " " << erased << replaced << " " << kvstore.get(0) << " " << kvstore.get(0, 4) << " " 
+         << kvstore.trySet(0, 7) << kvstore.tryErase(1) << kvstore.trySet(9, 9) << " " << kvstore.size() << endl;
+}
+
+void testFixedVersions() {
+    VersionedKvStore<int, int, FixedCapacity<4, 8, 4>> kvstore;
+    for (int version = 0; version < 10; ++version) {
+        kvstore.trySet(0, version);
+        kvstore.save();
+    }
+    cout << kvstore.maxVersion() << " " << kvstore.oldestRetainedVersion() << " " << kvstore.get(0, 8) << " " 
+         << kvstore.size(0) << kvstore.size(8) << endl;
+}
+
+void testKnownKeys() {
+    VersionedKvStore<string, string, KnownKeys<ConfigFields>> kvstore;
+    kvstore.set("timeout_ms", "250");
+    kvstore.set("endpoint", "localhost:8080");
+    kvstore.save();
+    kvstore.set("timeout_ms", "500");
+    kvstore.erase("endpoint");
+    bool rejected = false;
+    try {
+        kvstore.set("unknown", "1");
+    } catch (const out_of_range&) {
+        rejected = true;
+    }
+    cout << kvstore.get("timeout_ms") << " " << kvstore.get("timeout_ms", 0) << " " << kvstore.get("endpoint", 0) 
+         << " " << kvstore.exists("endpoint") << kvstore.exists("unknown") << rejected << " " << kvstore.size() << endl;
+}
+
 int main() {
     // testSetBasic();
     // testEraseBasic();
@@ -84,4 +659,36 @@ int main() {
     // testSaveErased();
     // testSizeBasic();
     testValuePersistsBasic();
+    testMoveBasic();
+    testClearAsync();
+    testClearAsyncSettings();
+    testChangeFeedBasic();
+    testChangeLogTail();
+    testChangeLogBlocking();
+    testTtlVersions();
+    testSpillBasic();
+    testSpillChurn();
+    testReadModifyWrite();
+    testTransactionConflict();
+    testTransactionSquash();
+    testDeltaValues();
+    testRadixKeys();
+    testArtKeys();
+    testLifetimeExists();
+    testAliveIntervals();
+    testPolicyPresets();
+    testHistoryIndex();
+    testReclaimDeadKeys();
+    testReclaimTransaction();
+    testSquash();
+    testRetentionTiers();
+    testRetentionTransaction();
+    testKeyHandles();
+    testSwissKeys();
+    testFastHash();
+    testDenseKeys();
+    testSmallStore();
+    testFixedCapacity();
+    testFixedVersions();
+    testKnownKeys();
 }
\ No newline at end of file